@@ -1,9 +1,20 @@
 
 #include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include "GL/glew.h"
 #include "Buffers.h"
+#include "MeshOptimizer.h"
+#include "MeshIO.h"
 #include "Logger.h"
+#include "DebugDraw.h"
 
 
 GLuint create_buffer( const GLenum target, const GLint64 length, const void *data, const GLenum usage )
@@ -14,14 +25,7 @@ GLuint create_buffer( const GLenum target, const GLint64 length, const void *dat
         return 0;
     
     glBindBuffer(target, buffer);
-    if(data != NULL)
-        glBufferData(target, length, data, usage);
-    else
-    {
-        std::vector<unsigned char> zeroes(length, 0);
-        glBufferData(target, length, &zeroes.front(), usage);
-    }
-    
+    glBufferData(target, length, data, usage);
     return buffer;
 }
 
@@ -36,88 +40,1222 @@ GLuint create_vertex_array( )
     return bindings;
 }
 
-// simplistic maya obj reader, assumes vertices are already in vbo order
-Mesh read_OBJ( const char *filename )
+
+//! buffer of an arena, and its free ranges.
+struct ArenaBlock
 {
-    FILE *in= fopen(filename, "rb");
-    if(in == NULL)
+    GLuint buffer;
+    GLint64 length;
+    std::map<GLint64, GLint64> free;    //!< offset, length
+    std::map<GLint64, GLint64> used;
+};
+
+struct BufferArena
+{
+    std::vector<ArenaBlock> blocks;
+    GLint64 block_length;
+    GLint64 alignment;
+};
+
+BufferArena *create_arena( const GLint64 block_length, const GLint64 alignment )
+{
+    BufferArena *arena= new BufferArena;
+    arena->alignment= std::max((GLint64) 1, alignment);
+    arena->block_length= std::max(block_length, arena->alignment);
+    return arena;
+}
+
+BufferRange arena_allocate( BufferArena *arena, const GLint64 length, const void *data )
+{
+    BufferRange range;
+    if(arena == NULL || length <= 0)
+        return range;
+    
+    // free ranges start on an alignment boundary, allocated lengths are rounded up
+    const GLint64 size= (length + arena->alignment -1) / arena->alignment * arena->alignment;
+    
+    // first fit
+    unsigned int b= 0;
+    std::map<GLint64, GLint64>::iterator found;
+    for(; b < arena->blocks.size(); b++)
     {
-        ERROR("error loading mesh '%s'.\n", filename);
-        return Mesh();
+        std::map<GLint64, GLint64>& free= arena->blocks[b].free;
+        for(found= free.begin(); found != free.end(); ++found)
+            if(found->second >= size)
+                break;
+        if(found != free.end())
+            break;
     }
     
-    std::vector<float> positions;
-    std::vector<float> normals;
-    std::vector<int> indices;
+    if(b == arena->blocks.size())
+    {
+        // new block, large enough for the range
+        ArenaBlock block;
+        block.length= std::max(arena->block_length, size);
+        block.buffer= 0;
+        
+        // GL_COPY_WRITE_BUFFER does not change the element array of the current vertex array
+        glGenBuffers(1, &block.buffer);
+        if(block.buffer == 0)
+            return range;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, block.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, block.length, NULL, GL_STATIC_DRAW);
+        
+        block.free[0]= block.length;
+        arena->blocks.push_back(block);
+        found= arena->blocks.back().free.begin();
+    }
+    
+    ArenaBlock& block= arena->blocks[b];
+    range.buffer= block.buffer;
+    range.offset= found->first;
+    range.length= size;
+    
+    GLint64 remaining= found->second - size;
+    block.free.erase(found);
+    if(remaining > 0)
+        block.free[range.offset + size]= remaining;
+    block.used[range.offset]= size;
+    
+    if(data != NULL)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, range.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.offset, length, data);
+    }
+    
+    return range;
+}
+
+void arena_free( BufferArena *arena, const GLuint buffer, const GLint64 offset )
+{
+    if(arena == NULL || buffer == 0)
+        return;
+    
+    for(unsigned int b= 0; b < arena->blocks.size(); b++)
+    {
+        if(arena->blocks[b].buffer != buffer)
+            continue;
+        
+        std::map<GLint64, GLint64>::iterator used= arena->blocks[b].used.find(offset);
+        if(used == arena->blocks[b].used.end())
+            return;     // not allocated
+        
+        GLint64 length= used->second;
+        arena->blocks[b].used.erase(used);
+        
+        std::map<GLint64, GLint64>& free= arena->blocks[b].free;
+        
+        // merges with the next free range
+        std::map<GLint64, GLint64>::iterator next= free.find(offset + length);
+        if(next != free.end())
+        {
+            length+= next->second;
+            free.erase(next);
+        }
+        
+        // and the previous one
+        bool merged= false;
+        std::map<GLint64, GLint64>::iterator previous= free.lower_bound(offset);
+        if(previous != free.begin())
+        {
+            --previous;
+            if(previous->first + previous->second == offset)
+            {
+                previous->second+= length;
+                merged= true;
+            }
+        }
+        
+        if(!merged)
+            free[offset]= length;
+        
+        // deletes the buffer of a block without ranges, the arena keeps at least one block
+        if(arena->blocks[b].used.empty() && arena->blocks.size() > 1)
+        {
+            glDeleteBuffers(1, &arena->blocks[b].buffer);
+            arena->blocks.erase(arena->blocks.begin() + b);
+        }
+        return;
+    }
+}
+
+void release_arena( BufferArena *arena )
+{
+    if(arena == NULL)
+        return;
+    
+    for(unsigned int b= 0; b < arena->blocks.size(); b++)
+        glDeleteBuffers(1, &arena->blocks[b].buffer);
+    delete arena;
+}
+
+
+//! glBufferStorage( ) and persistent mappings need openGL 4.4, each region is mapped without synchronization, 
+//! while it is written, fences guard its reuse.
+struct RingBuffer
+{
+    GLuint buffer;
+    GLint64 region_length;
+    GLint64 alignment;
+    std::vector<GLsync> fences;         //!< one per region, signaled when the gpu is done with the region
+    int region;         //!< current region, or -1
+    bool used;          //!< current region was written, since ring_begin( )
+    unsigned char *data;        //!< mapped region
+    GLint64 head;       //!< next allocation in the mapped region
+    unsigned int stalls;        //!< ring_begin( ) waited for the gpu
+};
+
+RingBuffer *create_ring_buffer( const GLint64 region_length, const int region_count, const GLint64 alignment )
+{
+    if(region_length <= 0 || region_count <= 0)
+        return NULL;
+    
+    RingBuffer *ring= new RingBuffer;
+    ring->alignment= std::max((GLint64) 1, alignment);
+    ring->region_length= (region_length + ring->alignment -1) / ring->alignment * ring->alignment;
+    ring->fences.resize(region_count, 0);
+    ring->region= -1;
+    ring->used= false;
+    ring->data= NULL;
+    ring->head= 0;
+    ring->stalls= 0;
+    
+    ring->buffer= 0;
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, ring->region_length * region_count, NULL, GL_STREAM_DRAW);
+    return ring;
+}
+
+GLuint ring_buffer( const RingBuffer *ring )
+{
+    if(ring == NULL)
+        return 0;
+    return ring->buffer;
+}
+
+//! waits for the fence of a region, and deletes it. returns false on error.
+static
+bool ring_wait( RingBuffer *ring, const int region )
+{
+    GLsync& fence= ring->fences[region];
+    if(fence == 0)
+        return true;
+    
+    GLenum status= glClientWaitSync(fence, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED)
+    {
+        ring->stalls++;
+        // flushes the commands, or the fence may never be signaled
+        status= glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);       // 1s
+        while(status == GL_TIMEOUT_EXPIRED)
+            status= glClientWaitSync(fence, 0, 1000000000);
+    }
+    
+    glDeleteSync(fence);
+    fence= 0;
+    return status != GL_WAIT_FAILED;
+}
+
+int ring_begin( RingBuffer *ring )
+{
+    if(ring == NULL || ring->buffer == 0 || ring->data != NULL)
+        return -1;
+    
+    // the draws using the previous region were submitted, fence them
+    if(ring->region >= 0 && ring->used)
+        ring->fences[ring->region]= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    const int count= (int) ring->fences.size();
+    ring->region= (ring->region +1) % count;
+    ring->used= false;
+    ring->head= 0;
+    if(ring_wait(ring, ring->region) == false)
+        return -1;
+    
+    // the gpu is done with the region, no need for the driver to synchronize
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    ring->data= (unsigned char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, ring->region * ring->region_length, ring->region_length, 
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    return (ring->data != NULL) ? 0 : -1;
+}
+
+void *ring_allocate( RingBuffer *ring, const GLint64 length, GLint64& offset )
+{
+    offset= 0;
+    if(ring == NULL || ring->data == NULL || length <= 0)
+        return NULL;
+    
+    GLint64 size= (length + ring->alignment -1) / ring->alignment * ring->alignment;
+    if(ring->head + size > ring->region_length)
+        return NULL;
+    
+    void *data= ring->data + ring->head;
+    offset= ring->region * ring->region_length + ring->head;
+    ring->head+= size;
+    ring->used= true;
+    return data;
+}
+
+int ring_end( RingBuffer *ring )
+{
+    if(ring == NULL || ring->data == NULL)
+        return -1;
+    
+    ring->data= NULL;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    if(glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE)
+        return -1;
     
-    char line[1024];
-    for(;;)
+    // invalidates the DebugDraw results computed from the previous content of the buffer
+    if(ring->used)
+        gk::DebugBufferChanged(ring->buffer);
+    return 0;
+}
+
+void release_ring_buffer( RingBuffer *ring )
+{
+    if(ring == NULL)
+        return;
+    
+    if(ring->stalls > 0)
+        MESSAGE("ring buffer %u: waited for the gpu %u times, use more or larger regions.\n", ring->buffer, ring->stalls);
+    
+    if(ring->data != NULL)
+        ring_end(ring);
+    for(unsigned int i= 0; i < ring->fences.size(); i++)
+        ring_wait(ring, i);
+    glDeleteBuffers(1, &ring->buffer);
+    delete ring;
+}
+
+
+//! reorders triangles and vertices according to flags, reports acmr and vertex fetch before / after.
+static
+void optimize_mesh( const char *filename, const unsigned int flags, 
+    std::vector<unsigned int>& indices, std::vector<float>& positions, std::vector<float>& texcoords, std::vector<float>& normals )
+{
+    if((flags & MESH_OPTIMIZE) == 0 || indices.size() < 3)
+        return;
+    
+    // size of the attributes in their buffers, after quantization, cf. upload_mesh( )
+    int vertex_sizes[3];
+    int streams= 0;
+    vertex_sizes[streams++]= (flags & MESH_QUANTIZE_POSITIONS) ? sizeof(unsigned short [4]) : sizeof(float [3]);
+    if(texcoords.size() > 0)
+        vertex_sizes[streams++]= sizeof(float [2]);
+    if(normals.size() > 0)
+        vertex_sizes[streams++]= (flags & MESH_QUANTIZE_NORMALS) ? sizeof(unsigned int) : sizeof(float [3]);
+    
+    const int cache_size= 16;
+    MeshCacheStats stats= mesh_cache_stats(indices, (int) positions.size() / 3, vertex_sizes, streams, cache_size);
+    
+    if(flags & (MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW))
+    {
+        std::vector<unsigned int> clusters= optimize_vertex_cache(indices, (int) positions.size() / 3, cache_size);
+        if(flags & MESH_OPTIMIZE_OVERDRAW)
+            optimize_overdraw(indices, clusters, positions, cache_size);
+    }
+    if(flags & MESH_OPTIMIZE_VERTEX_FETCH)
+        optimize_vertex_fetch(indices, positions, texcoords, normals);
+    
+    MeshCacheStats optimized= mesh_cache_stats(indices, (int) positions.size() / 3, vertex_sizes, streams, cache_size);
+    MESSAGE("optimizing mesh '%s': acmr %.3f -> %.3f, atvr %.3f -> %.3f (fifo %d), vertex fetch %.3f -> %.3f\n", 
+        filename, stats.acmr, optimized.acmr, stats.atvr, optimized.atvr, cache_size, 
+        stats.overfetch, optimized.overfetch);
+}
+
+//! packs a normal in a GL_INT_2_10_10_10_REV, snorm10 x, y, z, w= 0.
+static
+unsigned int pack_snorm10( const float x, const float y, const float z )
+{
+    const float v[3]= { x, y, z };
+    unsigned int packed= 0;
+    for(int i= 0; i < 3; i++)
+    {
+        int q= (int) floorf(std::max(-1.f, std::min(1.f, v[i])) * 511.f + .5f);
+        packed|= ((unsigned int) q & 0x3ff) << (10 * i);
+    }
+    
+    return packed;
+}
+
+static
+float unpack_snorm10( const unsigned int packed, const int i )
+{
+    int q= (int) ((packed >> (10 * i)) & 0x3ff);
+    if(q >= 512)
+        q-= 1024;       // sign extension
+    return std::max(-1.f, (float) q / 511.f);
+}
+
+//! simplifies the mesh in up to 7 levels, each one with about half the triangles of the previous one, cf. MESH_LODS.
+//! appends their index ranges to indices, the error of a level is the sum of the errors of the simplifications leading to it.
+static
+void build_lods( const char *filename, const unsigned int flags, 
+    std::vector<unsigned int>& indices, const std::vector<float>& positions, std::vector<MeshLod>& lods )
+{
+    std::chrono::high_resolution_clock::time_point start= std::chrono::high_resolution_clock::now();
+    
+    MeshLod lod= { 0, (int) indices.size(), 0.f };
+    lods.push_back(lod);
+    
+    std::vector<unsigned int> level(indices);
+    while(lods.size() < 8)
     {
-        line[0]= 0;
-        if(fgets(line, sizeof(line), in) == NULL)
+        unsigned int target= (unsigned int) level.size() / 6 * 3;
+        if(target < 3*64)
             break;
         
-        line[1023]= 0;   // ends the string
-        if(line[0] == 'v')
+        float error= 0.f;
+        std::vector<unsigned int> simplified= simplify(level, positions, target, error);
+        if(simplified.size() * 10 > level.size() * 9)
+            break;      // can't simplify further
+        
+        if(flags & MESH_OPTIMIZE_VERTEX_CACHE)
+            optimize_vertex_cache(simplified, (int) positions.size() / 3);
+        
+        lod.first= (int) indices.size();
+        lod.count= (int) simplified.size();
+        lod.error+= error;      // each level is simplified from the previous one, distances add up
+        lods.push_back(lod);
+        
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        level.swap(simplified);
+    }
+    
+    int ms= (int) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    for(unsigned int i= 1; i < lods.size(); i++)
+        MESSAGE("mesh '%s': lod %u, %d triangles, error %g\n", filename, i, lods[i].count / 3, lods[i].error);
+    MESSAGE("mesh '%s': %d lods, %dms\n", filename, (int) lods.size(), ms);
+}
+
+//! final buffer contents, uploaded by upload_mesh( ) and stored in the cache, cf. MESH_CACHE.
+struct MeshArrays
+{
+    std::vector<unsigned char> positions;
+    std::vector<unsigned char> texcoords;
+    std::vector<unsigned char> normals;
+    std::vector<unsigned char> indices;
+    std::vector<unsigned char> clusters;
+};
+
+template < typename T >
+static
+void assign_bytes( std::vector<unsigned char>& bytes, const std::vector<T>& data )
+{
+    if(data.empty())
+        bytes.clear();
+    else
+        bytes.assign((const unsigned char *) &data.front(), (const unsigned char *) &data.front() + data.size() * sizeof(T));
+}
+
+//! converts positions, normals and indices to their final formats, according to flags, texcoords stay floats.
+static
+void pack_mesh( const char *filename, const unsigned int flags, 
+    const std::vector<unsigned int>& indices, 
+    const std::vector<float>& positions, const std::vector<float>& texcoords, const std::vector<float>& normals, 
+    Mesh& mesh, MeshArrays& arrays )
+{
+    const unsigned int vertex_count= (unsigned int) positions.size() / 3;
+    const GLint64 float_length= (GLint64) (positions.size() + texcoords.size() + normals.size()) * sizeof(float) 
+        + (GLint64) indices.size() * sizeof(unsigned int);
+    GLint64 length= 0;
+    
+    if((flags & MESH_QUANTIZE_POSITIONS) && vertex_count > 0)
+    {
+        // uniform scale, dequantization is a similarity and does not change normals
+        float bmin[3]= { positions[0], positions[1], positions[2] };
+        float bmax[3]= { positions[0], positions[1], positions[2] };
+        for(unsigned int i= 0; i < vertex_count; i++)
+            for(int k= 0; k < 3; k++)
+            {
+                bmin[k]= std::min(bmin[k], positions[3*i + k]);
+                bmax[k]= std::max(bmax[k], positions[3*i + k]);
+            }
+        
+        float extent= std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+        if(extent <= 0.f)
+            extent= 1.f;
+        
+        std::vector<GLushort> quantized(vertex_count * 4);
+        float error= 0.f;
+        for(unsigned int i= 0; i < vertex_count; i++)
         {
-            if(line[1] == ' ')  // position
+            for(int k= 0; k < 3; k++)
             {
-                float x, y, z;
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                positions.push_back(x);
-                positions.push_back(y);
-                positions.push_back(z);
+                float v= (positions[3*i + k] - bmin[k]) / extent;
+                GLushort q= (GLushort) floorf(std::max(0.f, std::min(1.f, v)) * 65535.f + .5f);
+                quantized[4*i + k]= q;
+                error= std::max(error, fabsf(bmin[k] + extent * (float) q / 65535.f - positions[3*i + k]));
             }
-            else if(line[1] == 'n')     // normal
+            quantized[4*i + 3]= 65535;  // w= 1
+        }
+        
+        assign_bytes(arrays.positions, quantized);
+        mesh.position_size= 4;
+        mesh.position_type= GL_UNSIGNED_SHORT;
+        for(int k= 0; k < 3; k++)
+            mesh.position_offset[k]= bmin[k];
+        mesh.position_scale= extent;
+        length+= quantized.size() * sizeof(GLushort);
+        
+        MESSAGE("mesh '%s': unorm16 positions, max error %g (%.4f%% of the extent)\n", filename, error, error / extent * 100.f);
+    }
+    else if(vertex_count > 0)
+    {
+        assign_bytes(arrays.positions, positions);
+        length+= positions.size() * sizeof(float);
+    }
+    
+    assign_bytes(arrays.texcoords, texcoords);
+    length+= texcoords.size() * sizeof(float);
+    
+    if((flags & MESH_QUANTIZE_NORMALS) && normals.size() > 0)
+    {
+        std::vector<GLuint> quantized(vertex_count);
+        float error= 1.f;       // cos of the angle error
+        for(unsigned int i= 0; i < vertex_count; i++)
+        {
+            float x= normals[3*i];
+            float y= normals[3*i +1];
+            float z= normals[3*i +2];
+            float l= sqrtf(x*x + y*y + z*z);
+            if(l > 0.f)
             {
-                float x, y, z;
-                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
-                    break;
-                normals.push_back(x);
-                normals.push_back(y);
-                normals.push_back(z);
+                x/= l;
+                y/= l;
+                z/= l;
             }
+            
+            quantized[i]= pack_snorm10(x, y, z);
+            
+            float qx= unpack_snorm10(quantized[i], 0);
+            float qy= unpack_snorm10(quantized[i], 1);
+            float qz= unpack_snorm10(quantized[i], 2);
+            float ql= sqrtf(qx*qx + qy*qy + qz*qz);
+            if(l > 0.f && ql > 0.f)
+                error= std::min(error, (x*qx + y*qy + z*qz) / ql);
         }
         
-        else if(line[0] == 'f') // triangle
+        assign_bytes(arrays.normals, quantized);
+        mesh.normal_size= 4;
+        mesh.normal_type= GL_INT_2_10_10_10_REV;
+        length+= quantized.size() * sizeof(GLuint);
+        
+        MESSAGE("mesh '%s': snorm10 normals, max error %.3f degrees\n", filename, acosf(std::min(1.f, error)) * 180.f / (float) M_PI);
+    }
+    else if(normals.size() > 0)
+    {
+        assign_bytes(arrays.normals, normals);
+        length+= normals.size() * sizeof(float);
+    }
+    
+    if((flags & MESH_COMPACT_INDICES) && indices.size() > 0 && vertex_count <= 65536)
+    {
+        std::vector<GLushort> compact(indices.begin(), indices.end());
+        assign_bytes(arrays.indices, compact);
+        mesh.index_type= GL_UNSIGNED_SHORT;
+        length+= compact.size() * sizeof(GLushort);
+    }
+    else if(indices.size() > 0)
+    {
+        assign_bytes(arrays.indices, indices);
+        length+= indices.size() * sizeof(unsigned int);
+    }
+    
+    if(flags & MESH_QUANTIZE)
+        MESSAGE("mesh '%s': %ld bytes, %ld bytes saved (%.1f%%)\n", filename, 
+            (long int) length, (long int) (float_length - length), 100.f * (float) (float_length - length) / (float) float_length);
+}
+
+//! cache sections.
+enum {
+    CACHE_MESH= 1,      //!< MeshInfo
+    CACHE_POSITIONS,
+    CACHE_NORMALS,
+    CACHE_INDICES,
+    CACHE_CLUSTERS,
+    CACHE_LODS,         //!< MeshLod array
+    CACHE_TEXCOORDS
+};
+
+//! Mesh formats and counts, stored in the cache.
+struct MeshInfo
+{
+    int count;
+    int cluster_count;
+    GLint position_size;
+    GLenum position_type;
+    GLint texcoord_size;
+    GLenum texcoord_type;
+    GLint normal_size;
+    GLenum normal_type;
+    GLenum index_type;
+    float position_offset[3];
+    float position_scale;
+};
+
+//! buffer of the mesh receiving a section, or NULL.
+//! offset is NULL if the section is not suballocated in an arena.
+static
+GLuint *section_buffer( const unsigned int id, Mesh& mesh, GLenum& target, GLint64 *& offset )
+{
+    target= GL_ARRAY_BUFFER;
+    offset= NULL;
+    if(id == CACHE_POSITIONS)
+    {
+        offset= &mesh.positions_offset;
+        return &mesh.positions;
+    }
+    if(id == CACHE_TEXCOORDS)
+    {
+        offset= &mesh.texcoords_offset;
+        return &mesh.texcoords;
+    }
+    if(id == CACHE_NORMALS)
+    {
+        offset= &mesh.normals_offset;
+        return &mesh.normals;
+    }
+    if(id == CACHE_CLUSTERS)
+        return &mesh.clusters;
+    
+    target= GL_ELEMENT_ARRAY_BUFFER;
+    if(id == CACHE_INDICES)
+    {
+        offset= &mesh.indices_offset;
+        return &mesh.indices;
+    }
+    return NULL;
+}
+
+//! creates the buffers of a mesh, from its sections, or allocates them in arena.
+static
+void upload_mesh( const std::vector<CacheSection>& sections, Mesh& mesh, BufferArena *arena )
+{
+    for(unsigned int i= 0; i < sections.size(); i++)
+    {
+        GLenum target;
+        GLint64 *offset;
+        GLuint *buffer= section_buffer(sections[i].id, mesh, target, offset);
+        if(buffer == NULL || sections[i].length == 0)
+            continue;
+        
+        if(arena != NULL && offset != NULL)
         {
-            int a, b, c;
-            if(sscanf(line, "f %d %d %d", &a, &b, &c) != 3
-            && sscanf(line, "f %d//%*d %d//%*d %d//%*d", &a, &b, &c) != 3
-            && sscanf(line, "f %d/%*d/%*d %d/%*d/%*d %d/%*d/%*d", &a, &b, &c) != 3)
-                break;
-            indices.push_back(a -1);
-            indices.push_back(b -1);
-            indices.push_back(c -1);
+            BufferRange range= arena_allocate(arena, sections[i].length, sections[i].data);
+            *buffer= range.buffer;
+            *offset= range.offset;
         }
+        else
+            *buffer= create_buffer(target, sections[i].length, sections[i].data);
     }
+}
+
+//! host side of a mesh: formats and buffer contents, built by load_mesh( ), or mapped from the cache.
+struct MeshSource
+{
+    Mesh mesh;          //!< formats and counts, without buffers
+    MeshArrays arrays;
+    MeshInfo info;
+    MappedFile cache;
+    std::vector<CacheSection> sections;         //!< buffer contents, in arrays or in the mapped cache
+};
+
+static
+void release_source( MeshSource& source )
+{
+    unmap_file(source.cache);
+    source.sections.clear();
+    source.arrays= MeshArrays();
+}
+
+//! maps the cache of a mesh, returns -1 if the cache is missing or out of date.
+static
+int read_mesh_cache( const char *filename, const std::string& cache, const FileStamp& stamp, const unsigned int flags, MeshSource& source )
+{
+    std::chrono::high_resolution_clock::time_point start= std::chrono::high_resolution_clock::now();
     
-    fclose(in);
+    MappedFile& file= source.cache;
+    std::vector<CacheSection>& sections= source.sections;
+    if(read_cache(cache.c_str(), stamp, flags, file, sections) < 0)
+        return -1;
     
-    if(positions.size() == 0)
+    const MeshInfo *info= NULL;
+    const MeshLod *lods= NULL;
+    int lod_count= 0;
+    for(unsigned int i= 0; i < sections.size(); i++)
     {
-        ERROR("error loading mesh '%s'. no positions.\n");
-        return Mesh();
+        if(sections[i].id == CACHE_MESH && sections[i].length == sizeof(MeshInfo))
+            info= (const MeshInfo *) sections[i].data;
+        else if(sections[i].id == CACHE_LODS)
+        {
+            lods= (const MeshLod *) sections[i].data;
+            lod_count= (int) (sections[i].length / sizeof(MeshLod));
+        }
     }
     
-    if(normals.size() > 0 && normals.size() != positions.size())
+    if(info == NULL)
     {
-        ERROR("error loading mesh '%s'. invalid format (not a vbo).\n");
-        return Mesh();
+        release_source(source);
+        return -1;
     }
     
-    Mesh mesh;
-    if(indices.size() > 0)
-        mesh.indices= create_buffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), &indices.front());
-    if(normals.size() > 0)
-        mesh.normals= create_buffer(GL_ARRAY_BUFFER, normals.size() * sizeof(float), &normals.front());
+    Mesh& mesh= source.mesh;
+    mesh.count= info->count;
+    mesh.cluster_count= info->cluster_count;
+    mesh.position_size= info->position_size;
+    mesh.position_type= info->position_type;
+    mesh.texcoord_size= info->texcoord_size;
+    mesh.texcoord_type= info->texcoord_type;
+    mesh.normal_size= info->normal_size;
+    mesh.normal_type= info->normal_type;
+    mesh.index_type= info->index_type;
+    for(int k= 0; k < 3; k++)
+        mesh.position_offset[k]= info->position_offset[k];
+    mesh.position_scale= info->position_scale;
+    if(lods != NULL)
+        mesh.lods.assign(lods, lods + lod_count);
+    
+    size_t size= file.size;
+    double seconds= std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    MESSAGE("loading mesh '%s' from '%s': %.1fMB in %.1fms, %.1fMB/s... done.\n", filename, cache.c_str(), 
+        (double) size / (1024.0 * 1024.0), seconds * 1000.0, (double) size / (1024.0 * 1024.0) / std::max(seconds, 1e-9));
+    return 0;
+}
+
+//! describes the mesh buffers, and formats stored in info.
+static
+std::vector<CacheSection> mesh_sections( const Mesh& mesh, const MeshArrays& arrays, MeshInfo& info )
+{
+    memset(&info, 0, sizeof(info));
+    info.count= mesh.count;
+    info.cluster_count= mesh.cluster_count;
+    info.position_size= mesh.position_size;
+    info.position_type= mesh.position_type;
+    info.texcoord_size= mesh.texcoord_size;
+    info.texcoord_type= mesh.texcoord_type;
+    info.normal_size= mesh.normal_size;
+    info.normal_type= mesh.normal_type;
+    info.index_type= mesh.index_type;
+    for(int k= 0; k < 3; k++)
+        info.position_offset[k]= mesh.position_offset[k];
+    info.position_scale= mesh.position_scale;
+    
+    const CacheSection sections[]= {
+        { CACHE_MESH, sizeof(info), &info },
+        { CACHE_POSITIONS, arrays.positions.size(), arrays.positions.empty() ? NULL : &arrays.positions.front() },
+        { CACHE_NORMALS, arrays.normals.size(), arrays.normals.empty() ? NULL : &arrays.normals.front() },
+        { CACHE_INDICES, arrays.indices.size(), arrays.indices.empty() ? NULL : &arrays.indices.front() },
+        { CACHE_CLUSTERS, arrays.clusters.size(), arrays.clusters.empty() ? NULL : &arrays.clusters.front() },
+        { CACHE_LODS, mesh.lods.size() * sizeof(MeshLod), mesh.lods.empty() ? NULL : &mesh.lods.front() },
+        { CACHE_TEXCOORDS, arrays.texcoords.size(), arrays.texcoords.empty() ? NULL : &arrays.texcoords.front() }
+    };
+    return std::vector<CacheSection>(sections, sections + sizeof(sections) / sizeof(sections[0]));
+}
+
+//! writes a buffer through successive mapped ranges, cf. MESH_STREAM.
+//! ranges of an arena buffer are written through a host chunk instead: the other streams use the same buffer, 
+//! and a buffer can't be mapped twice.
+struct BufferStream
+{
+    GLuint buffer;
+    GLint64 base;       //!< offset of the range in an arena buffer
+    GLint64 length;
+    GLint64 offset;     //!< mapped range, or staged chunk
+    GLint64 size;
+    GLint64 used;
+    unsigned char *data;
+    std::vector<unsigned char> staging;         //!< chunk copied with glBufferSubData( ), when the buffer is shared
+    
+    BufferStream( ) : buffer(0), base(0), length(0), offset(0), size(0), used(0), data(NULL), staging() {}
+    
+    //! allocates the buffer, or a range in arena, without initializing it.
+    void create( const GLint64 _length, BufferArena *arena )
+    {
+        if(arena != NULL)
+        {
+            BufferRange range= arena_allocate(arena, _length);
+            buffer= range.buffer;
+            base= range.offset;
+            staging.resize(std::min(_length, (GLint64) 1024 * 1024));
+        }
+        else
+        {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, _length, NULL, GL_STATIC_DRAW);
+        }
+        length= _length;
+    }
+    
+    bool unmap( )
+    {
+        if(data == NULL)
+            return true;
+        
+        data= NULL;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if(staging.size() > 0)
+        {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, base + offset, used, &staging.front());
+            return true;
+        }
+        return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+    }
     
-    mesh.positions= create_buffer(GL_ARRAY_BUFFER, positions.size() * sizeof(float), &positions.front());
+    //! maps the next range of the buffer, a few MB at a time, or stages the next chunk.
+    bool map_next( )
+    {
+        const GLint64 range= (staging.size() > 0) ? (GLint64) staging.size() : 4 * 1024 * 1024;
+        if(unmap() == false)
+            return false;
+        
+        offset+= size;
+        used= 0;
+        size= std::min(range, length - offset);
+        if(size <= 0)
+            return false;
+        
+        if(staging.size() > 0)
+            data= &staging.front();
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            data= (unsigned char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, base + offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+        return data != NULL;
+    }
+    
+    bool write( const void *v, GLint64 n )
+    {
+        const unsigned char *bytes= (const unsigned char *) v;
+        while(n > 0)
+        {
+            if(used == size && map_next() == false)
+                return false;
+            
+            GLint64 m= std::min(n, size - used);
+            memcpy(data + used, bytes, m);
+            used+= m;
+            bytes+= m;
+            n-= m;
+        }
+        
+        return true;
+    }
+    
+    void release( BufferArena *arena )
+    {
+        unmap();
+        if(arena != NULL)
+        {
+            if(buffer != 0)
+                arena_free(arena, buffer, base);
+        }
+        else if(buffer != 0)
+            glDeleteBuffers(1, &buffer);
+        buffer= 0;
+    }
+};
+
+//! writes the vertices and indices of a vbo file in their buffers, as they are parsed.
+struct MeshStream : public ObjStream
+{
+    ObjCounts counts;
+    BufferStream positions;
+    BufferStream texcoords;
+    BufferStream normals;
+    BufferStream indices;
+    bool vbo;           //!< false if a corner uses different position / texcoord / normal indices
+    
+    MeshStream( const ObjCounts& _counts ) : counts(_counts), positions(), texcoords(), normals(), indices(), vbo(true) {}
+    
+    bool position( const float *v ) { return positions.write(v, sizeof(float [3])); }
+    bool texcoord( const float *v ) { return texcoords.buffer == 0 || texcoords.write(v, sizeof(float [2])); }
+    bool normal( const float *v ) { return normals.buffer == 0 || normals.write(v, sizeof(float [3])); }
+    
+    bool triangle( const int *corners )
+    {
+        unsigned int triangle[3];
+        for(int k= 0; k < 3; k++)
+        {
+            const int *corner= corners + 3*k;
+            if(corner[0] < 0 || (size_t) corner[0] >= counts.positions)
+                return false;
+            if((corner[1] != -1 && corner[1] != corner[0]) || (corner[2] != -1 && corner[2] != corner[0]))
+            {
+                vbo= false;
+                return false;
+            }
+            
+            triangle[k]= (unsigned int) corner[0];
+        }
+        
+        return indices.write(triangle, sizeof(triangle));
+    }
+    
+    bool unmap( )
+    {
+        // unmaps all the buffers, even after a failure
+        bool ok= positions.unmap();
+        ok= texcoords.unmap() && ok;
+        ok= normals.unmap() && ok;
+        ok= indices.unmap() && ok;
+        return ok;
+    }
+    
+    void release( BufferArena *arena )
+    {
+        positions.release(arena);
+        texcoords.release(arena);
+        normals.release(arena);
+        indices.release(arena);
+    }
+};
+
+//! parses a vbo file directly in mapped buffers, without host arrays.
+//! returns 1 if the file is not a vbo, the mesh is then loaded by read_OBJ( ), or -1 on error.
+static
+int stream_mesh( const char *filename, Mesh& mesh, BufferArena *arena )
+{
+    std::chrono::high_resolution_clock::time_point start= std::chrono::high_resolution_clock::now();
+    
+    MappedFile file;
+    if(map_file(filename, file) < 0)
+    {
+        ERROR("error loading mesh '%s'.\n", filename);
+        return -1;
+    }
+    
+    ObjCounts counts;
+    count_OBJ(file.data, file.size, counts);
+    if(counts.positions == 0
+    || (counts.texcoords > 0 && counts.texcoords != counts.positions) 
+    || (counts.normals > 0 && counts.normals != counts.positions))
+    {
+        unmap_file(file);
+        return 1;
+    }
+    
+    MeshStream stream(counts);
+    stream.positions.create(counts.positions * sizeof(float [3]), arena);
+    if(counts.texcoords > 0)
+        stream.texcoords.create(counts.texcoords * sizeof(float [2]), arena);
+    if(counts.normals > 0)
+        stream.normals.create(counts.normals * sizeof(float [3]), arena);
+    if(counts.triangles > 0)
+        stream.indices.create(counts.triangles * sizeof(unsigned int [3]), arena);
+    
+    int code= parse_OBJ(filename, file.data, file.size, stream);
+    if(stream.unmap() == false)
+        code= -1;
+    unmap_file(file);
+    
+    if(code < 0)
+    {
+        stream.release(arena);
+        if(stream.vbo == false)
+            return 1;
+        
+        ERROR("error loading mesh '%s'. invalid index, or mapping failed.\n", filename);
+        return -1;
+    }
+    
+    mesh.positions= stream.positions.buffer;
+    mesh.texcoords= stream.texcoords.buffer;
+    mesh.normals= stream.normals.buffer;
+    mesh.indices= stream.indices.buffer;
+    mesh.positions_offset= stream.positions.base;
+    mesh.texcoords_offset= stream.texcoords.base;
+    mesh.normals_offset= stream.normals.base;
+    mesh.indices_offset= stream.indices.base;
+    mesh.count= counts.triangles > 0 ? (int) counts.triangles * 3 : (int) counts.positions;
+    
+    double seconds= std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    MESSAGE("loading mesh '%s', streamed: %d positions, %d texcoords, %d normals, %d indices, %.1fms... done.\n", filename, 
+        (int) counts.positions, (int) counts.texcoords, (int) counts.normals, (int) counts.triangles * 3, seconds * 1000.0);
+    return 0;
+}
+
+//! parses and processes a mesh, or maps its cache. no openGL calls, returns -1 on error.
+static
+int load_mesh( const char *filename, const unsigned int flags, MeshSource& source )
+{
+    const std::string cache= std::string(filename) + ".cache";
+    FileStamp stamp;
+    const bool use_cache= (flags & MESH_CACHE) && stamp_file(filename, stamp) == 0;
+    if(use_cache && read_mesh_cache(filename, cache, stamp, flags, source) == 0)
+        return 0;
+    
+    std::chrono::high_resolution_clock::time_point start= std::chrono::high_resolution_clock::now();
+    
+    ObjData obj;
+    size_t size= 0;
+    if(flags & MESH_LEGACY_PARSER)
+    {
+        FILE *in= fopen(filename, "rb");
+        if(in == NULL)
+        {
+            ERROR("error loading mesh '%s'.\n", filename);
+            return -1;
+        }
+        
+        fseek(in, 0, SEEK_END);
+        size= (size_t) ftell(in);
+        fseek(in, 0, SEEK_SET);
+        
+        int code= parse_OBJ_legacy(filename, in, obj);
+        fclose(in);
+        if(code < 0)
+            return -1;
+    }
+    else
+    {
+        MappedFile file;
+        if(map_file(filename, file) < 0)
+        {
+            ERROR("error loading mesh '%s'.\n", filename);
+            return -1;
+        }
+        
+        size= file.size;
+        int code= parse_OBJ(filename, file.data, file.size, obj);
+        unmap_file(file);
+        if(code < 0)
+            return -1;
+    }
+    
+    double seconds= std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    MESSAGE("mesh '%s': parsed %.1fMB in %.1fms, %.1fMB/s (%s parser)\n", filename, 
+        (double) size / (1024.0 * 1024.0), seconds * 1000.0, (double) size / (1024.0 * 1024.0) / std::max(seconds, 1e-9), 
+        (flags & MESH_LEGACY_PARSER) ? "sscanf" : "mmap");
+    
+    if(obj.positions.size() == 0)
+    {
+        ERROR("error loading mesh '%s'. no positions.\n", filename);
+        return -1;
+    }
+    
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    std::vector<float> normals;
+    if(obj.corners.size() > 0)
+    {
+        // a vertex for each unique position / texcoord / normal triplet
+        weld_OBJ(obj, indices, positions, texcoords, normals);
+        MESSAGE("mesh '%s': %d corners welded in %d vertices\n", filename, (int) indices.size(), (int) positions.size() / 3);
+    }
+    else
+    {
+        // no faces, attributes are used in order
+        positions.swap(obj.positions);
+        if(obj.texcoords.size() / 2 == positions.size() / 3)
+            texcoords.swap(obj.texcoords);
+        if(obj.normals.size() == positions.size())
+            normals.swap(obj.normals);
+    }
+    obj= ObjData();     // releases the parsed arrays
+    
+    optimize_mesh(filename, flags, indices, positions, texcoords, normals);
+    
+    // clusters and lod 0 use the full resolution triangles
+    std::vector<gk::DebugCluster> clusters;
+    if((flags & MESH_CLUSTERS) && indices.size() > 0)
+        clusters= build_clusters(indices, positions);
+    
+    Mesh& mesh= source.mesh;
     mesh.count= (int) indices.size() ? (int) indices.size() : (int) positions.size() / 3;
+    if((flags & MESH_LODS) && indices.size() > 0)
+        build_lods(filename, flags, indices, positions, mesh.lods);
+    
+    pack_mesh(filename, flags, indices, positions, texcoords, normals, mesh, source.arrays);
+    assign_bytes(source.arrays.clusters, clusters);
+    mesh.cluster_count= (int) clusters.size();
+    
+    source.sections= mesh_sections(mesh, source.arrays, source.info);
+    if(use_cache && write_cache(cache.c_str(), stamp, flags, source.sections) < 0)
+        WARNING("mesh '%s': can't write cache '%s'.\n", filename, cache.c_str());
+    
+    if(clusters.size() > 0)
+    {
+        int vertex_count= 0;
+        for(unsigned int i= 0; i < clusters.size(); i++)
+            vertex_count+= clusters[i].vertex_count;
+        MESSAGE("mesh '%s': %d clusters, %.1f triangles, %.1f vertices per cluster\n", filename, mesh.cluster_count, 
+            (float) mesh.count / 3.f / (float) clusters.size(), 
+            (float) vertex_count / (float) clusters.size());
+    }
+    
+    MESSAGE("loading mesh '%s': %d positions, %d texcoords, %d normals, %d indices... done.\n", 
+        filename, (int) positions.size() / 3, (int) texcoords.size() / 2, (int) normals.size() / 3, (int) indices.size());
+    return 0;
+}
+
+
+// simplistic maya obj reader
+Mesh read_OBJ( const char *filename, const unsigned int flags, BufferArena *arena )
+{
+    if(flags & MESH_STREAM)
+    {
+        const unsigned int host= MESH_OPTIMIZE | MESH_CLUSTERS | MESH_QUANTIZE | MESH_LODS | MESH_LEGACY_PARSER | MESH_CACHE;
+        if(flags & host)
+            WARNING("mesh '%s': MESH_STREAM ignored, the mesh is processed on the host.\n", filename);
+        else
+        {
+            Mesh mesh;
+            int code= stream_mesh(filename, mesh, arena);
+            if(code == 0)
+                return mesh;
+            if(code < 0)
+                return Mesh();
+            MESSAGE("mesh '%s': not a vbo, can't stream.\n", filename);
+        }
+    }
+    
+    MeshSource source;
+    if(load_mesh(filename, flags, source) < 0)
+        return Mesh();
     
-    MESSAGE("loading mesh '%s': %d positions, %d normals, %d indices... done.\n", 
-        filename, positions.size() / 3, normals.size() / 3, indices.size());
-    return mesh;
+    upload_mesh(source.sections, source.mesh, arena);
+    release_source(source);
+    return source.mesh;
 }
 
+void release_mesh( Mesh& mesh, BufferArena *arena )
+{
+    GLuint *buffers[]= { &mesh.positions, &mesh.texcoords, &mesh.normals, &mesh.indices };
+    GLint64 *offsets[]= { &mesh.positions_offset, &mesh.texcoords_offset, &mesh.normals_offset, &mesh.indices_offset };
+    for(unsigned int i= 0; i < sizeof(buffers) / sizeof(buffers[0]); i++)
+    {
+        if(*buffers[i] == 0)
+            continue;
+        
+        if(arena != NULL)
+            arena_free(arena, *buffers[i], *offsets[i]);
+        else
+            glDeleteBuffers(1, buffers[i]);
+        *buffers[i]= 0;
+        *offsets[i]= 0;
+    }
+    
+    // not suballocated
+    if(mesh.clusters != 0)
+        glDeleteBuffers(1, &mesh.clusters);
+    mesh.clusters= 0;
+}
+
+
+struct MeshRequest
+{
+    std::string filename;
+    unsigned int flags;
+    BufferArena *arena;
+    MeshSource source;
+    std::thread worker;
+    std::atomic<int> status;    //!< 0 while loading, 1 once loaded, -1 on error
+    
+    //! upload progress
+    unsigned int section;
+    GLint64 offset;
+    bool ready;         //!< buffers belong to the application
+    
+    MeshRequest( const char *_filename, const unsigned int _flags, BufferArena *_arena ) 
+        : filename(_filename), flags(_flags), arena(_arena), source(), worker(), status(0), section(0), offset(0), ready(false) {}
+};
+
+static
+void load_request( MeshRequest *request )
+{
+    request->status= (load_mesh(request->filename.c_str(), request->flags, request->source) < 0) ? -1 : 1;
+}
+
+MeshRequest *read_OBJ_async( const char *filename, const unsigned int flags, BufferArena *arena )
+{
+    if(flags & MESH_STREAM)
+        WARNING("mesh '%s': MESH_STREAM ignored, the mesh is loaded by a worker thread.\n", filename);
+    
+    MeshRequest *request= new MeshRequest(filename, flags & ~MESH_STREAM, arena);
+    request->worker= std::thread(load_request, request);
+    return request;
+}
+
+int upload_OBJ( MeshRequest *request, Mesh& mesh, const GLint64 budget )
+{
+    if(request == NULL)
+        return -1;
+    
+    int status= request->status;
+    if(status <= 0)
+        return status;
+    
+    MeshSource& source= request->source;
+    GLint64 remaining= budget;
+    for(; request->section < source.sections.size(); request->offset= 0, request->section++)
+    {
+        const CacheSection& section= source.sections[request->section];
+        GLenum target;
+        GLint64 *offset;
+        GLuint *buffer= section_buffer(section.id, source.mesh, target, offset);
+        if(buffer == NULL || section.length == 0)
+            continue;
+        
+        // allocates the buffer, or its range in the arena, then copies the section, a part per frame. 
+        // GL_COPY_WRITE_BUFFER does not change the element array of the current vertex array.
+        if(*buffer == 0)
+        {
+            if(request->arena != NULL && offset != NULL)
+            {
+                BufferRange range= arena_allocate(request->arena, section.length);
+                *buffer= range.buffer;
+                *offset= range.offset;
+            }
+            else
+            {
+                glGenBuffers(1, buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, *buffer);
+                glBufferData(GL_COPY_WRITE_BUFFER, section.length, NULL, GL_STATIC_DRAW);
+            }
+            
+            if(*buffer == 0)
+                return -1;
+        }
+        
+        GLint64 length= std::min(remaining, (GLint64) section.length - request->offset);
+        if(length > 0)
+        {
+            const GLint64 base= (offset != NULL) ? *offset : 0;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, *buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, base + request->offset, length, (const unsigned char *) section.data + request->offset);
+            request->offset+= length;
+            remaining-= length;
+        }
+        
+        if(request->offset < (GLint64) section.length)
+            return 0;   // budget exhausted, continues on the next frame
+    }
+    
+    mesh= source.mesh;
+    request->ready= true;
+    return 1;
+}
+
+void release_OBJ( MeshRequest *request )
+{
+    if(request == NULL)
+        return;
+    
+    if(request->worker.joinable())
+        request->worker.join();
+    
+    if(request->ready == false)
+    {
+        // released before the end of the upload
+        release_mesh(request->source.mesh, request->arena);
+    }
+    
+    release_source(request->source);
+    delete request;
+}
@@ -7,26 +7,152 @@
 #include "GL/glew.h"
 
 
+//! creates a buffer, its content is undefined when data is NULL.
 GLuint create_buffer( const GLenum target, const GLint64 length, const void *data= NULL, const GLenum usage= GL_STATIC_DRAW );
 GLuint create_vertex_array( );
 
+//! part of a buffer, allocated by arena_allocate( ).
+struct BufferRange
+{
+    GLuint buffer;
+    GLint64 offset;
+    GLint64 length;
+    
+    BufferRange( ) : buffer(0), offset(0), length(0) {}
+};
+
+//! suballocates vertex and index data in a few large buffers, instead of a buffer per attribute and per mesh.
+struct BufferArena;
+
+//! creates an arena, buffers are allocated block_length bytes at a time, ranges are aligned on alignment bytes.
+BufferArena *create_arena( const GLint64 block_length= 64 * 1024 * 1024, const GLint64 alignment= 256 );
+//! allocates a range, and copies data, if not NULL. returns a range with buffer 0 on error.
+BufferRange arena_allocate( BufferArena *arena, const GLint64 length, const void *data= NULL );
+//! frees the range allocated at offset in buffer, merged with its free neighbours.
+//! the buffer of a block is deleted once all its ranges are freed, the arena keeps at least one block.
+void arena_free( BufferArena *arena, const GLuint buffer, const GLint64 offset );
+//! deletes the buffers of the arena, and all their ranges.
+void release_arena( BufferArena *arena );
+
+//! per frame dynamic data: a buffer split in regions, written in turn, each region is reused once the gpu is done with it.
+//! usage, each frame: ring_begin( ), ring_allocate( ) and write, ring_end( ), then draw with the offsets.
+struct RingBuffer;
+
+//! creates a buffer of region_count regions of region_length bytes, allocations are aligned on alignment bytes.
+RingBuffer *create_ring_buffer( const GLint64 region_length, const int region_count= 3, const GLint64 alignment= 256 );
+//! buffer of the ring, to bind the regions.
+GLuint ring_buffer( const RingBuffer *ring );
+//! waits until the gpu is done with the next region, and maps it. returns -1 on error.
+int ring_begin( RingBuffer *ring );
+//! allocates length bytes in the current region, returns a write pointer, valid until ring_end( ), or NULL if the region is full.
+//! offset receives the byte offset of the allocation in the buffer, for glVertexAttribPointer( ), glDrawElements( ), etc.
+void *ring_allocate( RingBuffer *ring, const GLint64 length, GLint64& offset );
+//! unmaps the current region, draws using it can follow. returns -1 on error.
+int ring_end( RingBuffer *ring );
+//! waits for the gpu, and deletes the buffer.
+void release_ring_buffer( RingBuffer *ring );
+
+//! simplified level of detail, indices [first, first + count) of the index buffer, cf. MESH_LODS.
+struct MeshLod
+{
+    int first;
+    int count;
+    float error;        //!< geometric error bound, in position units
+};
+
 struct Mesh
 {
     GLuint positions;
+    GLuint texcoords;
     GLuint normals;
     GLuint indices;
+    GLuint clusters;    //!< gk::DebugCluster array, cf. MESH_CLUSTERS
+    
+    //! byte offset of the vertex and index data in their buffers, not 0 when the mesh is suballocated in an arena.
+    GLint64 positions_offset;
+    GLint64 texcoords_offset;
+    GLint64 normals_offset;
+    GLint64 indices_offset;
     
     int count;
+    int cluster_count;
+    
+    //! vertex and index formats, cf. glVertexAttribPointer( ), quantized types are normalized.
+    GLint position_size;
+    GLenum position_type;
+    GLint texcoord_size;
+    GLenum texcoord_type;
+    GLint normal_size;
+    GLenum normal_type;
+    GLenum index_type;
+    
+    //! dequantization of positions: p= offset + scale * position, cf. MESH_QUANTIZE_POSITIONS.
+    float position_offset[3];
+    float position_scale;
+    
+    //! lods[0] is the full resolution mesh, then each level uses about half the triangles.
+    std::vector<MeshLod> lods;
     
     Mesh( )
         :
         positions(0),
+        texcoords(0),
         normals(0),
         indices(0),
-        count(0)
-    {}
+        clusters(0),
+        positions_offset(0),
+        texcoords_offset(0),
+        normals_offset(0),
+        indices_offset(0),
+        count(0),
+        cluster_count(0),
+        position_size(3),
+        position_type(GL_FLOAT),
+        texcoord_size(2),
+        texcoord_type(GL_FLOAT),
+        normal_size(3),
+        normal_type(GL_FLOAT),
+        index_type(GL_UNSIGNED_INT),
+        position_scale(1.f)
+    {
+        position_offset[0]= 0.f;
+        position_offset[1]= 0.f;
+        position_offset[2]= 0.f;
+    }
+};
+
+//! read_OBJ( ) options.
+enum {
+    MESH_OPTIMIZE_VERTEX_CACHE= 1,      //!< reorders triangles for the post transform vertex cache
+    MESH_OPTIMIZE_OVERDRAW= 2,          //!< sorts clusters of triangles to reduce overdraw, implies MESH_OPTIMIZE_VERTEX_CACHE
+    MESH_OPTIMIZE_VERTEX_FETCH= 4,      //!< renumbers vertices in order of first use
+    MESH_OPTIMIZE= 7,
+    MESH_CLUSTERS= 8,   //!< partitions triangles in clusters of 64 vertices and 124 triangles, with bounding spheres and normal cones
+    MESH_QUANTIZE_POSITIONS= 16,        //!< GL_UNSIGNED_SHORT x 4 positions, w= 1, dequantized by position_offset and position_scale
+    MESH_QUANTIZE_NORMALS= 32,          //!< GL_INT_2_10_10_10_REV normals
+    MESH_COMPACT_INDICES= 64,           //!< GL_UNSIGNED_SHORT indices, when there is less than 65536 vertices
+    MESH_QUANTIZE= 112,
+    MESH_LODS= 128,     //!< simplified index ranges appended to the index buffer, cf. Mesh::lods
+    MESH_LEGACY_PARSER= 256,    //!< fgets / sscanf parser instead of the mapped file parser, to compare throughput
+    MESH_CACHE= 512,    //!< loads the binary cache 'filename.cache' when it matches the source file and flags, or writes it
+    MESH_STREAM= 1024   //!< parses vbo files directly in mapped buffers, without host arrays, only without the other options
 };
 
-Mesh read_OBJ( const char *filename );
+//! loads a mesh, vertex and index data are suballocated in arena, if not NULL, the cluster buffer is not.
+Mesh read_OBJ( const char *filename, const unsigned int flags= 0, BufferArena *arena= NULL );
+//! deletes the buffers of a mesh, or frees its ranges in arena.
+void release_mesh( Mesh& mesh, BufferArena *arena= NULL );
+
+//! mesh loaded by a worker thread, cf. read_OBJ_async( ).
+struct MeshRequest;
+
+//! starts loading a mesh on a worker thread, and returns immediately. MESH_STREAM is not available.
+MeshRequest *read_OBJ_async( const char *filename, const unsigned int flags= 0, BufferArena *arena= NULL );
+//! uploads the buffers of the loaded mesh, at most budget bytes per call. call once per frame, on the openGL context thread.
+//! returns 1 when mesh is ready, 0 while loading or uploading, -1 on error.
+int upload_OBJ( MeshRequest *request, Mesh& mesh, const GLint64 budget= 4 * 1024 * 1024 );
+//! waits for the worker thread, releases the request and the host copy of the mesh, on the openGL context thread.
+//! buffers are deleted, or freed in the arena, if the mesh was not ready.
+void release_OBJ( MeshRequest *request );
 
 #endif
@@ -19,6 +19,11 @@
 #include <cassert>
 #include <cmath>
 
+#if defined(__SSE__) || defined(_M_X64)
+#define GK_SSE 1
+#include <xmmintrin.h>
+#endif
+
 //! namespace pour regrouper les types et les fonctions.
 namespace gk {
 
@@ -37,7 +42,7 @@ class Vector
 public:
     // Vector Public Methods
     //! constructeur.
-    Vector( const float _x = 0.f, const float _y = 0.f, const float _z = 0.f )
+    constexpr Vector( const float _x = 0.f, const float _y = 0.f, const float _z = 0.f )
         : 
         x( _x ), y( _y ), z( _z )
     {}
@@ -181,22 +186,22 @@ class Point
 {
 public:
     // Point Methods
-    Point( )
+    constexpr Point( )
         :
         x(0.f), y(0.f), z(0.f)
     {}
     
-    Point( const float v )
+    constexpr Point( const float v )
         :
         x(v), y(v), z(v)
     {}
     
-    Point( const float _x, const float _y, const float _z )
+    constexpr Point( const float _x, const float _y, const float _z )
         :
         x( _x ), y( _y ), z( _z )
     {}
     
-    explicit Point( const Vector &v )
+    constexpr explicit Point( const Vector &v )
         : 
         x( v.x ), y( v.y ), z( v.z ) 
     {}
@@ -315,7 +320,7 @@ class Normal
 {
 public:
     // Normal Methods
-    Normal( const float _x = 0.f, const float _y = 0.f, const float _z = 0.f )
+    constexpr Normal( const float _x = 0.f, const float _y = 0.f, const float _z = 0.f )
         : 
         x( _x ), y( _y ), z( _z ) 
     {}
@@ -393,7 +398,7 @@ public:
         return sqrtf( LengthSquared() );
     }
     
-    explicit Normal( const Vector &v )
+    constexpr explicit Normal( const Vector &v )
         : 
         x( v.x ), y( v.y ), z( v.z ) 
     {}
@@ -694,6 +699,180 @@ float SphericalPhi( const Vector &v )
     return ( p < 0.f ) ? p + 2.f*M_PI : p;
 }
 
+
+//! boite englobante alignee sur les axes.
+//! pMin et pMax occupent 16 octets chacun, pour les operations sse, la 4ieme composante vaut 0.
+class BBox
+{
+public:
+    //! construit une boite vide.
+    BBox( )
+        :
+        pMin( HUGE_VALF ), pad0(0.f), 
+        pMax( -HUGE_VALF ), pad1(0.f)
+    {}
+    
+    //! construit la boite englobante d'un point.
+    BBox( const Point &p )
+        :
+        pMin( p ), pad0(0.f), 
+        pMax( p ), pad1(0.f)
+    {}
+    
+    //! construit la boite englobante de 2 points.
+    BBox( const Point &p1, const Point &p2 )
+        :
+        pMin( std::min(p1.x, p2.x), std::min(p1.y, p2.y), std::min(p1.z, p2.z) ), pad0(0.f), 
+        pMax( std::max(p1.x, p2.x), std::max(p1.y, p2.y), std::max(p1.z, p2.z) ), pad1(0.f)
+    {}
+    
+    //! construit la boite englobante de n points, x y z consecutifs.
+    BBox( const float *points, const int n );
+    
+    //! ajoute un point a la boite.
+    BBox &Extend( const Point &p )
+    {
+#ifdef GK_SSE
+        const __m128 v= _mm_setr_ps(p.x, p.y, p.z, 0.f);
+        _mm_store_ps(&pMin.x, _mm_min_ps(_mm_load_ps(&pMin.x), v));
+        _mm_store_ps(&pMax.x, _mm_max_ps(_mm_load_ps(&pMax.x), v));
+#else
+        pMin= Point( std::min(pMin.x, p.x), std::min(pMin.y, p.y), std::min(pMin.z, p.z) );
+        pMax= Point( std::max(pMax.x, p.x), std::max(pMax.y, p.y), std::max(pMax.z, p.z) );
+#endif
+        return *this;
+    }
+    
+    //! ajoute une boite a la boite.
+    BBox &Extend( const BBox &b )
+    {
+#ifdef GK_SSE
+        _mm_store_ps(&pMin.x, _mm_min_ps(_mm_load_ps(&pMin.x), _mm_load_ps(&b.pMin.x)));
+        _mm_store_ps(&pMax.x, _mm_max_ps(_mm_load_ps(&pMax.x), _mm_load_ps(&b.pMax.x)));
+#else
+        pMin= Point( std::min(pMin.x, b.pMin.x), std::min(pMin.y, b.pMin.y), std::min(pMin.z, b.pMin.z) );
+        pMax= Point( std::max(pMax.x, b.pMax.x), std::max(pMax.y, b.pMax.y), std::max(pMax.z, b.pMax.z) );
+#endif
+        return *this;
+    }
+    
+    //! renvoie vrai si la boite ne contient aucun point.
+    bool IsEmpty( ) const
+    {
+        return pMin.x > pMax.x || pMin.y > pMax.y || pMin.z > pMax.z;
+    }
+    
+    //! renvoie vrai si les 2 boites se touchent.
+    bool Overlaps( const BBox &b ) const
+    {
+        return (pMax.x >= b.pMin.x) && (pMin.x <= b.pMax.x)
+            && (pMax.y >= b.pMin.y) && (pMin.y <= b.pMax.y)
+            && (pMax.z >= b.pMin.z) && (pMin.z <= b.pMax.z);
+    }
+    
+    //! renvoie vrai si le point est a l'interieur de la boite.
+    bool Inside( const Point &p ) const
+    {
+        return (p.x >= pMin.x && p.x <= pMax.x 
+            && p.y >= pMin.y && p.y <= pMax.y 
+            && p.z >= pMin.z && p.z <= pMax.z);
+    }
+    
+    //! renvoie le centre de la boite.
+    Point Center( ) const
+    {
+        return Point( (pMin.x + pMax.x) * .5f, (pMin.y + pMax.y) * .5f, (pMin.z + pMax.z) * .5f );
+    }
+    
+    //! renvoie l'indice de l'axe le plus long.
+    int MaximumExtent( ) const
+    {
+        const Vector diag( pMin, pMax );
+        if(diag.x > diag.y && diag.x > diag.z)
+            return 0;
+        else if(diag.y > diag.z)
+            return 1;
+        else
+            return 2;
+    }
+    
+    //! renvoie la sphere englobante de la boite.
+    void BoundingSphere( Point &center, float &radius ) const
+    {
+        center= Center();
+        radius= Inside(center) ? Distance(center, pMax) : 0.f;
+    }
+    
+    //! affiche la boite.
+    void print( ) const
+    {
+        printf("[% -.8f % -.8f % -.8f] [% -.8f % -.8f % -.8f]\n", pMin.x, pMin.y, pMin.z, pMax.x, pMax.y, pMax.z);
+    }
+    
+    alignas(16) Point pMin;
+    float pad0;
+    alignas(16) Point pMax;
+    float pad1;
+};
+
+inline
+BBox::BBox( const float *points, const int n )
+    :
+    pMin( HUGE_VALF ), pad0(0.f), 
+    pMax( -HUGE_VALF ), pad1(0.f)
+{
+    if(n <= 0)
+        return;
+    
+#ifdef GK_SSE
+    // charge x y z et la composante x du point suivant, ignoree, le dernier point est charge separement
+    __m128 bmin= _mm_load_ps(&pMin.x);
+    __m128 bmax= _mm_load_ps(&pMax.x);
+    __m128 bmin2= bmin;
+    __m128 bmax2= bmax;
+    int i= 0;
+    for(; i +2 < n; i+= 2)
+    {
+        const __m128 a= _mm_loadu_ps(points + 3*i);
+        const __m128 b= _mm_loadu_ps(points + 3*i +3);
+        bmin= _mm_min_ps(bmin, a);
+        bmax= _mm_max_ps(bmax, a);
+        bmin2= _mm_min_ps(bmin2, b);
+        bmax2= _mm_max_ps(bmax2, b);
+    }
+    for(; i < n; i++)
+    {
+        const __m128 a= _mm_setr_ps(points[3*i], points[3*i +1], points[3*i +2], 0.f);
+        bmin= _mm_min_ps(bmin, a);
+        bmax= _mm_max_ps(bmax, a);
+    }
+    
+    _mm_store_ps(&pMin.x, _mm_min_ps(bmin, bmin2));
+    _mm_store_ps(&pMax.x, _mm_max_ps(bmax, bmax2));
+    pad0= 0.f;
+    pad1= 0.f;
+#else
+    for(int i= 0; i < n; i++)
+        Extend( Point(points[3*i], points[3*i +1], points[3*i +2]) );
+#endif
+}
+
+//! renvoie la boite englobante d'une boite et d'un point.
+inline
+BBox Union( const BBox &b, const Point &p )
+{
+    BBox ret= b;
+    return ret.Extend(p);
+}
+
+//! renvoie la boite englobante de 2 boites.
+inline
+BBox Union( const BBox &b1, const BBox &b2 )
+{
+    BBox ret= b1;
+    return ret.Extend(b2);
+}
+
 } // namespace
 
 #endif // PBRT_GEOMETRY_H
@@ -0,0 +1,937 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
+#include "MeshIO.h"
+#include "Logger.h"
+#include "Parallel.h"
+
+
+#ifdef _WIN32
+int map_file( const char *filename, MappedFile& file )
+{
+    file= MappedFile();
+    file.file= NULL;
+    file.mapping= NULL;
+    
+    HANDLE handle= CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(handle == INVALID_HANDLE_VALUE)
+        return -1;
+    
+    LARGE_INTEGER size;
+    if(GetFileSizeEx(handle, &size) == 0)
+    {
+        CloseHandle(handle);
+        return -1;
+    }
+    
+    file.file= handle;
+    file.size= (size_t) size.QuadPart;
+    if(file.size == 0)
+        return 0;
+    
+    file.mapping= CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(file.mapping != NULL)
+        file.data= (const char *) MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0);
+    if(file.data == NULL)
+    {
+        unmap_file(file);
+        return -1;
+    }
+    
+    return 0;
+}
+
+void unmap_file( MappedFile& file )
+{
+    if(file.data != NULL)
+        UnmapViewOfFile(file.data);
+    if(file.mapping != NULL)
+        CloseHandle(file.mapping);
+    if(file.file != NULL)
+        CloseHandle(file.file);
+    
+    file= MappedFile();
+    file.file= NULL;
+    file.mapping= NULL;
+}
+
+#else
+int map_file( const char *filename, MappedFile& file )
+{
+    file= MappedFile();
+    
+    int fd= open(filename, O_RDONLY);
+    if(fd < 0)
+        return -1;
+    
+    struct stat info;
+    if(fstat(fd, &info) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    
+    file.size= (size_t) info.st_size;
+    if(file.size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+    
+    void *data= mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if(data == MAP_FAILED)
+    {
+        file= MappedFile();
+        return -1;
+    }
+    
+    madvise(data, file.size, MADV_SEQUENTIAL);
+    file.data= (const char *) data;
+    return 0;
+}
+
+void unmap_file( MappedFile& file )
+{
+    if(file.data != NULL)
+        munmap((void *) file.data, file.size);
+    file= MappedFile();
+}
+#endif
+
+
+static inline
+bool is_blank( const char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline
+bool is_digit( const char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline
+const char *skip_blanks( const char *s, const char *end )
+{
+    while(s < end && is_blank(*s))
+        s++;
+    return s;
+}
+
+//! parses [+-]digits[.digits][(e|E)[+-]digits], returns the end of the number, or NULL.
+static
+const char *parse_float( const char *s, const char *end, float& v )
+{
+    // exact powers of 10, representable by a double
+    static const double powers[]= {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
+        negative= (*s++ == '-');
+    
+    // keeps the first 18 significant digits
+    unsigned long long int mantissa= 0;
+    int exponent= 0;
+    int digits= 0;
+    for(; s < end && is_digit(*s); s++, digits++)
+    {
+        if(mantissa < 100000000000000000ull)
+            mantissa= mantissa * 10 + (*s - '0');
+        else
+            exponent++;
+    }
+    
+    if(s < end && *s == '.')
+    {
+        s++;
+        for(; s < end && is_digit(*s); s++, digits++)
+        {
+            if(mantissa < 100000000000000000ull)
+            {
+                mantissa= mantissa * 10 + (*s - '0');
+                exponent--;
+            }
+        }
+    }
+    
+    if(digits == 0)
+        return NULL;
+    
+    if(s < end && (*s == 'e' || *s == 'E'))
+    {
+        s++;
+        bool negative_exponent= false;
+        if(s < end && (*s == '-' || *s == '+'))
+            negative_exponent= (*s++ == '-');
+        if(s == end || !is_digit(*s))
+            return NULL;
+        
+        int e= 0;
+        for(; s < end && is_digit(*s); s++)
+            if(e < 10000)
+                e= e * 10 + (*s - '0');
+        exponent+= negative_exponent ? -e : e;
+    }
+    
+    double x= (double) mantissa;
+    if(mantissa != 0 && exponent != 0)
+    {
+        int e= exponent < 0 ? -exponent : exponent;
+        double scale= (e <= 22) ? powers[e] : pow(10.0, (double) e);
+        x= (exponent < 0) ? x / scale : x * scale;
+    }
+    
+    v= (float) (negative ? -x : x);
+    return s;
+}
+
+//! parses [+-]digits, returns the end of the number, or NULL.
+static
+const char *parse_int( const char *s, const char *end, int& v )
+{
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
+        negative= (*s++ == '-');
+    if(s == end || !is_digit(*s))
+        return NULL;
+    
+    long long int x= 0;
+    for(; s < end && is_digit(*s); s++)
+        if(x < 0x7fffffff)
+            x= x * 10 + (*s - '0');
+    
+    v= (int) (negative ? -x : x);
+    return s;
+}
+
+//! parses n floats, returns the end of the line, or NULL.
+static
+const char *parse_floats( const char *s, const char *end, const int n, float *v )
+{
+    for(int i= 0; i < n; i++)
+    {
+        s= skip_blanks(s, end);
+        s= parse_float(s, end, v[i]);
+        if(s == NULL || (s < end && !is_blank(*s)))
+            return NULL;
+    }
+    
+    return s;
+}
+
+//! converts a 1 based, or relative, obj index to a 0 based index, returns false for 0.
+static inline
+bool resolve_index( const int index, const size_t count, int& v, bool& relative )
+{
+    relative= (index < 0);
+    v= (index > 0) ? index -1 : (int) count + index;
+    return index != 0;
+}
+
+//! parses the lines [begin, end), sink receives attributes and triangles: 
+//! sink.position( v ), sink.texcoord( v ), sink.normal( v ), sink.triangle( corners, relative ), they return false to stop.
+//! relative indices are resolved against the attributes of [begin, end).
+//! returns 0, or the line of the parse error, lines is the number of lines parsed.
+template < class Sink >
+static
+int parse_lines( const char *begin, const char *end, Sink& sink, int& lines )
+{
+    size_t positions= 0;
+    size_t texcoords= 0;
+    size_t normals= 0;
+    int line= 1;
+    for(const char *s= begin; s < end; line++)
+    {
+        const char *eol= (const char *) memchr(s, '\n', end - s);
+        if(eol == NULL)
+            eol= end;
+        
+        s= skip_blanks(s, eol);
+        if(eol - s >= 2 && s[0] == 'v')
+        {
+            float v[3]= { 0.f, 0.f, 0.f };
+            if(is_blank(s[1]))  // position, w is ignored
+            {
+                if(parse_floats(s +1, eol, 3, v) == NULL || !sink.position(v))
+                    break;
+                positions++;
+            }
+            else if(s[1] == 'n' && eol - s > 2 && is_blank(s[2]))       // normal
+            {
+                if(parse_floats(s +2, eol, 3, v) == NULL || !sink.normal(v))
+                    break;
+                normals++;
+            }
+            else if(s[1] == 't' && eol - s > 2 && is_blank(s[2]))       // texcoord, v is optional, w is ignored
+            {
+                const char *next= parse_floats(s +2, eol, 1, v);
+                if(next == NULL)
+                    break;
+                if(skip_blanks(next, eol) < eol && parse_floats(next, eol, 1, v +1) == NULL)
+                    break;
+                if(!sink.texcoord(v))
+                    break;
+                texcoords++;
+            }
+        }
+        
+        else if(eol - s >= 2 && s[0] == 'f' && is_blank(s[1]))  // polygon
+        {
+            int corners[9];     // first, previous and current corners of the fan
+            bool relative[9];
+            int n= 0;
+            bool error= false;
+            const char *p= s +1;
+            for(; !error;)
+            {
+                p= skip_blanks(p, eol);
+                if(p == eol)
+                    break;
+                
+                // v, v/t, v//n, v/t/n
+                int *corner= (n == 0) ? corners : corners + 6;
+                bool *corner_relative= (n == 0) ? relative : relative + 6;
+                corner[0]= -1; corner[1]= -1; corner[2]= -1;
+                corner_relative[0]= false; corner_relative[1]= false; corner_relative[2]= false;
+                
+                int index;
+                p= parse_int(p, eol, index);
+                if(p == NULL || !resolve_index(index, positions, corner[0], corner_relative[0]))
+                {
+                    error= true;
+                    break;
+                }
+                
+                if(p < eol && *p == '/')
+                {
+                    p++;
+                    if(p < eol && *p != '/')
+                    {
+                        p= parse_int(p, eol, index);
+                        if(p == NULL || !resolve_index(index, texcoords, corner[1], corner_relative[1]))
+                            error= true;
+                    }
+                    
+                    if(!error && p < eol && *p == '/')
+                    {
+                        p= parse_int(p +1, eol, index);
+                        if(p == NULL || !resolve_index(index, normals, corner[2], corner_relative[2]))
+                            error= true;
+                    }
+                }
+                
+                if(error || (p < eol && !is_blank(*p)))
+                {
+                    error= true;
+                    break;
+                }
+                
+                // triangle fan
+                if(n >= 2 && !sink.triangle(corners, relative))
+                    error= true;
+                if(n >= 1)
+                {
+                    memcpy(corners + 3, corners + 6, 3 * sizeof(int));
+                    memcpy(relative + 3, relative + 6, 3 * sizeof(bool));
+                }
+                n++;
+            }
+            
+            if(error || n < 3)
+                break;
+        }
+        
+        // other statements are ignored: comments, groups, materials, lines, etc.
+        s= eol +1;
+        if(s >= end)
+        {
+            lines= line;
+            return 0;
+        }
+    }
+    
+    lines= line;
+    return (begin < end) ? line : 0;
+}
+
+
+//! parsed lines of a part of the file.
+//! relative indices are resolved against the attributes of the chunk, fixups lists the corresponding corners[] entries,
+//! they are offset by the attributes of the previous chunks when the chunks are merged.
+struct ObjChunk
+{
+    const char *begin;
+    const char *end;
+    
+    ObjData obj;
+    std::vector<unsigned int> fixups;
+    int lines;
+    int error_line;     //!< 0, or the line of the parse error, in the chunk
+    
+    //! place of the chunk in the merged arrays, prefix sums of the previous chunks.
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t corners;
+    
+    ObjChunk( ) : begin(NULL), end(NULL), obj(), fixups(), lines(0), error_line(0), positions(0), texcoords(0), normals(0), corners(0) {}
+    
+    bool position( const float *v )
+    {
+        obj.positions.insert(obj.positions.end(), v, v + 3);
+        return true;
+    }
+    
+    bool texcoord( const float *v )
+    {
+        obj.texcoords.insert(obj.texcoords.end(), v, v + 2);
+        return true;
+    }
+    
+    bool normal( const float *v )
+    {
+        obj.normals.insert(obj.normals.end(), v, v + 3);
+        return true;
+    }
+    
+    bool triangle( const int *corners, const bool *relative )
+    {
+        unsigned int slot= (unsigned int) obj.corners.size();
+        for(int k= 0; k < 9; k++)
+            if(relative[k])
+                fixups.push_back(slot + k);
+        
+        obj.corners.insert(obj.corners.end(), corners, corners + 9);
+        return true;
+    }
+};
+
+static
+void parse_chunk( ObjChunk& chunk )
+{
+    chunk.error_line= parse_lines(chunk.begin, chunk.end, chunk, chunk.lines);
+}
+
+//! copies a chunk at its place in the merged arrays, offsets its relative indices.
+static
+void merge_chunk( const ObjChunk& chunk, ObjData& obj )
+{
+    const ObjData& data= chunk.obj;
+    std::copy(data.positions.begin(), data.positions.end(), obj.positions.begin() + chunk.positions);
+    std::copy(data.texcoords.begin(), data.texcoords.end(), obj.texcoords.begin() + chunk.texcoords);
+    std::copy(data.normals.begin(), data.normals.end(), obj.normals.begin() + chunk.normals);
+    std::copy(data.corners.begin(), data.corners.end(), obj.corners.begin() + chunk.corners);
+    
+    const int offsets[3]= { (int) chunk.positions / 3, (int) chunk.texcoords / 2, (int) chunk.normals / 3 };
+    for(unsigned int i= 0; i < chunk.fixups.size(); i++)
+    {
+        unsigned int slot= chunk.fixups[i];
+        obj.corners[chunk.corners + slot]+= offsets[slot % 3];
+    }
+}
+
+//! checks that the corners reference existing attributes, returns the index of the first invalid corner, or corners.size().
+static
+size_t check_corners( const ObjData& obj )
+{
+    const int counts[3]= { (int) obj.positions.size() / 3, (int) obj.texcoords.size() / 2, (int) obj.normals.size() / 3 };
+    for(size_t i= 0; i < obj.corners.size(); i++)
+    {
+        int index= obj.corners[i];
+        if(index < -1 || index >= counts[i % 3] || (index == -1 && i % 3 == 0))
+            return i;
+    }
+    return obj.corners.size();
+}
+
+//! parses the chunks [begin, end).
+struct parse_chunks_task
+{
+    std::vector<ObjChunk> *chunks;
+    
+    void operator()( const unsigned int begin, const unsigned int end ) const
+    {
+        for(unsigned int i= begin; i < end; i++)
+            parse_chunk((*chunks)[i]);
+    }
+};
+
+//! merges the chunks [begin, end).
+struct merge_chunks_task
+{
+    const std::vector<ObjChunk> *chunks;
+    ObjData *obj;
+    
+    void operator()( const unsigned int begin, const unsigned int end ) const
+    {
+        for(unsigned int i= begin; i < end; i++)
+            merge_chunk((*chunks)[i], *obj);
+    }
+};
+
+int parse_OBJ( const char *filename, const char *data, const size_t size, ObjData& obj )
+{
+    // splits the file in chunks of complete lines, a few per thread to balance the work
+    const unsigned int threads= worker_count();
+    size_t chunk_size= std::max(size / (threads * 4), (size_t) 1024*1024);
+    
+    std::vector<ObjChunk> chunks;
+    for(const char *begin= data, *end= data + size; begin < end; )
+    {
+        const char *split= begin + std::min(chunk_size, (size_t) (end - begin));
+        if(split < end)
+        {
+            split= (const char *) memchr(split, '\n', end - split);
+            split= (split == NULL) ? end : split +1;
+        }
+        
+        chunks.push_back(ObjChunk());
+        chunks.back().begin= begin;
+        chunks.back().end= split;
+        begin= split;
+    }
+    
+    {
+        parse_chunks_task task;
+        task.chunks= &chunks;
+        parallel_for((unsigned int) chunks.size(), task, 1);
+    }
+    
+    // prefix sums
+    ObjChunk total;
+    int line= 0;
+    for(unsigned int i= 0; i < chunks.size(); i++)
+    {
+        if(chunks[i].error_line > 0)
+        {
+            ERROR("error loading mesh '%s'. parse error, line %d.\n", filename, line + chunks[i].error_line);
+            return -1;
+        }
+        line+= chunks[i].lines;
+        
+        chunks[i].positions= total.positions;
+        chunks[i].texcoords= total.texcoords;
+        chunks[i].normals= total.normals;
+        chunks[i].corners= total.corners;
+        total.positions+= chunks[i].obj.positions.size();
+        total.texcoords+= chunks[i].obj.texcoords.size();
+        total.normals+= chunks[i].obj.normals.size();
+        total.corners+= chunks[i].obj.corners.size();
+    }
+    
+    if(chunks.size() == 1)
+        std::swap(obj, chunks[0].obj);
+    else if(chunks.size() > 1)
+    {
+        obj.positions.resize(total.positions);
+        obj.texcoords.resize(total.texcoords);
+        obj.normals.resize(total.normals);
+        obj.corners.resize(total.corners);
+        
+        merge_chunks_task task;
+        task.chunks= &chunks;
+        task.obj= &obj;
+        parallel_for((unsigned int) chunks.size(), task, 1);
+    }
+    
+    // indices are checked once all the attributes are known
+    size_t invalid= check_corners(obj);
+    if(invalid != obj.corners.size())
+    {
+        ERROR("error loading mesh '%s'. invalid index %d, triangle %d.\n", filename, obj.corners[invalid], (int) (invalid / 9));
+        return -1;
+    }
+    
+    return 0;
+}
+
+
+void count_OBJ( const char *data, const size_t size, ObjCounts& counts )
+{
+    counts.positions= 0;
+    counts.texcoords= 0;
+    counts.normals= 0;
+    counts.triangles= 0;
+    
+    const char *end= data + size;
+    for(const char *s= data; s < end; )
+    {
+        const char *eol= (const char *) memchr(s, '\n', end - s);
+        if(eol == NULL)
+            eol= end;
+        
+        s= skip_blanks(s, eol);
+        if(eol - s >= 2 && s[0] == 'v')
+        {
+            if(is_blank(s[1]))
+                counts.positions++;
+            else if(eol - s > 2 && is_blank(s[2]))
+            {
+                if(s[1] == 't')
+                    counts.texcoords++;
+                else if(s[1] == 'n')
+                    counts.normals++;
+            }
+        }
+        else if(eol - s >= 2 && s[0] == 'f' && is_blank(s[1]))
+        {
+            // a triangle for each corner after the second one
+            int n= 0;
+            for(const char *p= s +1; p < eol; )
+            {
+                p= skip_blanks(p, eol);
+                if(p == eol)
+                    break;
+                n++;
+                while(p < eol && !is_blank(*p))
+                    p++;
+            }
+            if(n >= 3)
+                counts.triangles+= n - 2;
+        }
+        
+        s= eol +1;
+    }
+}
+
+//! forwards parse_lines( ) to a stream.
+struct StreamSink
+{
+    ObjStream& stream;
+    bool stopped;
+    
+    StreamSink( ObjStream& _stream ) : stream(_stream), stopped(false) {}
+    
+    bool position( const float *v ) { return !(stopped= !stream.position(v)); }
+    bool texcoord( const float *v ) { return !(stopped= !stream.texcoord(v)); }
+    bool normal( const float *v ) { return !(stopped= !stream.normal(v)); }
+    bool triangle( const int *corners, const bool * ) { return !(stopped= !stream.triangle(corners)); }
+};
+
+int parse_OBJ( const char *filename, const char *data, const size_t size, ObjStream& stream )
+{
+    StreamSink sink(stream);
+    int lines= 0;
+    int line= parse_lines(data, data + size, sink, lines);
+    if(line > 0 && !sink.stopped)
+        ERROR("error loading mesh '%s'. parse error, line %d.\n", filename, line);
+    return (line > 0) ? -1 : 0;
+}
+
+
+static inline
+unsigned int hash_corner( const int *corner )
+{
+    unsigned int h= (unsigned int) corner[0] * 73856093u ^ (unsigned int) corner[1] * 19349663u ^ (unsigned int) corner[2] * 83492791u;
+    // murmur3 finalizer, spreads the bits for the power of 2 table
+    h^= h >> 16;
+    h*= 0x85ebca6bu;
+    h^= h >> 13;
+    h*= 0xc2b2ae35u;
+    h^= h >> 16;
+    return h;
+}
+
+//! open addressing, linear probing, slots store the first corner of each vertex.
+static
+unsigned int insert_corner( std::vector<unsigned int>& table, const std::vector<int>& corners, const unsigned int corner, const unsigned int value )
+{
+    const unsigned int mask= (unsigned int) table.size() -1;
+    const int *key= &corners[3*corner];
+    for(unsigned int h= hash_corner(key) & mask; ; h= (h +1) & mask)
+    {
+        if(table[h] == ~0u)
+        {
+            table[h]= value;
+            return value;
+        }
+        
+        const int *slot= &corners[3*table[h]];
+        if(slot[0] == key[0] && slot[1] == key[1] && slot[2] == key[2])
+            return table[h];
+    }
+}
+
+void weld_OBJ( const ObjData& obj, std::vector<unsigned int>& indices, 
+    std::vector<float>& positions, std::vector<float>& texcoords, std::vector<float>& normals )
+{
+    const std::vector<int>& corners= obj.corners;
+    const unsigned int corner_count= (unsigned int) corners.size() / 3;
+    
+    // the table is sized for the largest attribute array, and doubles when it is half full
+    size_t estimate= std::max(obj.positions.size() / 3, std::max(obj.texcoords.size() / 2, obj.normals.size() / 3));
+    size_t capacity= 1024;
+    while(capacity < 2 * estimate)
+        capacity*= 2;
+    
+    std::vector<unsigned int> table(capacity, ~0u);
+    std::vector<unsigned int> vertices;         // first corner of each vertex
+    vertices.reserve(estimate);
+    indices.resize(corner_count);
+    
+    bool has_texcoords= false;
+    bool has_normals= false;
+    for(unsigned int i= 0; i < corner_count; i++)
+    {
+        unsigned int v= insert_corner(table, corners, i, i);
+        if(v == i)
+        {
+            // new vertex
+            has_texcoords= has_texcoords || corners[3*i +1] >= 0;
+            has_normals= has_normals || corners[3*i +2] >= 0;
+            indices[i]= (unsigned int) vertices.size();
+            vertices.push_back(i);
+            
+            if(vertices.size() * 2 > table.size())
+            {
+                table.assign(table.size() * 2, ~0u);
+                for(unsigned int k= 0; k < vertices.size(); k++)
+                    insert_corner(table, corners, vertices[k], vertices[k]);
+            }
+        }
+        else
+            indices[i]= indices[v];     // index of the vertex, assigned to its first corner
+    }
+    
+    const unsigned int vertex_count= (unsigned int) vertices.size();
+    positions.assign(vertex_count * 3, 0.f);
+    texcoords.assign(has_texcoords ? vertex_count * 2 : 0, 0.f);
+    normals.assign(has_normals ? vertex_count * 3 : 0, 0.f);
+    for(unsigned int v= 0; v < vertex_count; v++)
+    {
+        const int *corner= &corners[3*vertices[v]];
+        for(int k= 0; k < 3; k++)
+            positions[3*v + k]= obj.positions[3*corner[0] + k];
+        if(has_texcoords && corner[1] >= 0)
+            for(int k= 0; k < 2; k++)
+                texcoords[2*v + k]= obj.texcoords[2*corner[1] + k];
+        if(has_normals && corner[2] >= 0)
+            for(int k= 0; k < 3; k++)
+                normals[3*v + k]= obj.normals[3*corner[2] + k];
+    }
+}
+
+
+//! fnv-1a, cf. http://www.isthe.com/chongo/tech/comp/fnv/
+static
+unsigned long long int hash_bytes( const unsigned char *data, const size_t length, unsigned long long int hash )
+{
+    for(size_t i= 0; i < length; i++)
+    {
+        hash^= data[i];
+        hash*= 1099511628211ull;
+    }
+    return hash;
+}
+
+int stamp_file( const char *filename, FileStamp& stamp )
+{
+    struct stat info;
+    if(stat(filename, &info) < 0)
+        return -1;
+    
+    stamp.size= (unsigned long long int) info.st_size;
+    stamp.mtime= (long long int) info.st_mtime;
+    stamp.hash= 14695981039346656037ull;
+    
+    // the whole source is not read: the stamp is checked before loading a cache
+    FILE *in= fopen(filename, "rb");
+    if(in == NULL)
+        return -1;
+    
+    std::vector<unsigned char> block(65536);
+    size_t n= fread(&block.front(), 1, block.size(), in);
+    stamp.hash= hash_bytes(&block.front(), n, stamp.hash);
+    if(stamp.size > block.size() && fseek(in, -(long int) block.size(), SEEK_END) == 0)
+    {
+        n= fread(&block.front(), 1, block.size(), in);
+        stamp.hash= hash_bytes(&block.front(), n, stamp.hash);
+    }
+    
+    fclose(in);
+    return 0;
+}
+
+
+static const char cache_magic[8]= { 'G', 'K', 'M', 'E', 'S', 'H', 0, 1 };
+
+struct CacheHeader
+{
+    char magic[8];
+    unsigned int key;
+    unsigned int section_count;
+    FileStamp stamp;
+};
+
+struct CacheDescriptor
+{
+    unsigned int id;
+    unsigned int pad;
+    unsigned long long int offset;
+    unsigned long long int length;
+};
+
+static inline
+unsigned long long int align64( const unsigned long long int offset )
+{
+    return (offset + 63) & ~63ull;
+}
+
+int write_cache( const char *filename, const FileStamp& stamp, const unsigned int key, const std::vector<CacheSection>& sections )
+{
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cache_magic, sizeof(header.magic));
+    header.key= key;
+    header.section_count= (unsigned int) sections.size();
+    header.stamp= stamp;
+    
+    std::vector<CacheDescriptor> descriptors(sections.size());
+    unsigned long long int offset= align64(sizeof(CacheHeader) + sizeof(CacheDescriptor) * sections.size());
+    for(unsigned int i= 0; i < sections.size(); i++)
+    {
+        descriptors[i].id= sections[i].id;
+        descriptors[i].pad= 0;
+        descriptors[i].offset= offset;
+        descriptors[i].length= sections[i].length;
+        offset= align64(offset + sections[i].length);
+    }
+    
+    // writes a temporary file, then replaces the cache: a reader never maps a partial file
+    std::string tmp= std::string(filename) + ".tmp";
+    FILE *out= fopen(tmp.c_str(), "wb");
+    if(out == NULL)
+        return -1;
+    
+    static const char zeroes[64]= { 0 };
+    bool ok= fwrite(&header, sizeof(header), 1, out) == 1;
+    if(ok && descriptors.size() > 0)
+        ok= fwrite(&descriptors.front(), sizeof(CacheDescriptor), descriptors.size(), out) == descriptors.size();
+    
+    unsigned long long int position= sizeof(CacheHeader) + sizeof(CacheDescriptor) * sections.size();
+    for(unsigned int i= 0; ok && i < sections.size(); i++)
+    {
+        ok= fwrite(zeroes, 1, descriptors[i].offset - position, out) == descriptors[i].offset - position;
+        if(ok && sections[i].length > 0)
+            ok= fwrite(sections[i].data, 1, sections[i].length, out) == sections[i].length;
+        position= descriptors[i].offset + sections[i].length;
+    }
+    
+    if(fclose(out) != 0)
+        ok= false;
+    if(ok && rename(tmp.c_str(), filename) != 0)
+        ok= false;
+    if(!ok)
+    {
+        remove(tmp.c_str());
+        return -1;
+    }
+    
+    return 0;
+}
+
+int read_cache( const char *filename, const FileStamp& stamp, const unsigned int key, MappedFile& file, std::vector<CacheSection>& sections )
+{
+    sections.clear();
+    if(map_file(filename, file) < 0)
+        return -1;
+    
+    const CacheHeader *header= (const CacheHeader *) file.data;
+    if(file.size < sizeof(CacheHeader)
+    || memcmp(header->magic, cache_magic, sizeof(cache_magic)) != 0
+    || header->key != key
+    || header->stamp.size != stamp.size || header->stamp.mtime != stamp.mtime || header->stamp.hash != stamp.hash
+    || file.size < sizeof(CacheHeader) + sizeof(CacheDescriptor) * (unsigned long long int) header->section_count)
+    {
+        unmap_file(file);
+        return -1;
+    }
+    
+    const CacheDescriptor *descriptors= (const CacheDescriptor *) (file.data + sizeof(CacheHeader));
+    for(unsigned int i= 0; i < header->section_count; i++)
+    {
+        if(descriptors[i].offset > file.size || descriptors[i].length > file.size - descriptors[i].offset)
+        {
+            sections.clear();
+            unmap_file(file);
+            return -1;
+        }
+        
+        CacheSection section= { descriptors[i].id, descriptors[i].length, file.data + descriptors[i].offset };
+        sections.push_back(section);
+    }
+    
+    return 0;
+}
+
+
+int parse_OBJ_legacy( const char *filename, FILE *in, ObjData& obj )
+{
+    char line[1024];
+    for(;;)
+    {
+        line[0]= 0;
+        if(fgets(line, sizeof(line), in) == NULL)
+            break;
+        
+        line[1023]= 0;   // ends the string
+        if(line[0] == 'v')
+        {
+            if(line[1] == ' ')  // position
+            {
+                float x, y, z;
+                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
+                    break;
+                obj.positions.push_back(x);
+                obj.positions.push_back(y);
+                obj.positions.push_back(z);
+            }
+            else if(line[1] == 'n')     // normal
+            {
+                float x, y, z;
+                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
+                    break;
+                obj.normals.push_back(x);
+                obj.normals.push_back(y);
+                obj.normals.push_back(z);
+            }
+        }
+        
+        else if(line[0] == 'f') // triangle
+        {
+            int a, b, c;
+            if(sscanf(line, "f %d %d %d", &a, &b, &c) != 3
+            && sscanf(line, "f %d//%*d %d//%*d %d//%*d", &a, &b, &c) != 3
+            && sscanf(line, "f %d/%*d/%*d %d/%*d/%*d %d/%*d/%*d", &a, &b, &c) != 3)
+                break;
+            
+            int corners[9]= { a -1, -1, -1, b -1, -1, -1, c -1, -1, -1 };
+            obj.corners.insert(obj.corners.end(), corners, corners + 9);
+        }
+    }
+    
+    // vbo format: the normal and position indices are the same
+    if(obj.normals.size() == obj.positions.size())
+        for(unsigned int i= 0; i < obj.corners.size(); i+= 3)
+            obj.corners[i +2]= obj.corners[i];
+    
+    return 0;
+}
@@ -0,0 +1,110 @@
+
+#ifndef _MESH_IO_H
+#define _MESH_IO_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+
+//! read only file mapping.
+struct MappedFile
+{
+    const char *data;
+    size_t size;
+
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+
+    MappedFile( ) : data(NULL), size(0) {}
+};
+
+//! maps a file in memory, returns -1 on error.
+int map_file( const char *filename, MappedFile& file );
+//! unmaps a file.
+void unmap_file( MappedFile& file );
+
+
+//! obj file contents.
+//! faces are triangulated, each corner references a position, a texcoord and a normal, with 0 based indices, or -1.
+struct ObjData
+{
+    std::vector<float> positions;       //!< x y z
+    std::vector<float> texcoords;       //!< u v
+    std::vector<float> normals;         //!< x y z
+    std::vector<int> corners;           //!< position, texcoord, normal index triplets, 3 corners per triangle
+};
+
+//! parses an obj file in memory: v, vt, vn and f, relative (negative) indices, polygons are triangulated as fans.
+//! numbers are parsed by hand, independently of the locale. returns -1 on error.
+//! the file is split in chunks of complete lines, parsed in parallel, then merged.
+int parse_OBJ( const char *filename, const char *data, const size_t size, ObjData& obj );
+
+//! number of attributes and triangles of an obj file.
+struct ObjCounts
+{
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t triangles;
+};
+
+//! counts the attributes and triangles of an obj file in memory, without parsing numbers.
+void count_OBJ( const char *data, const size_t size, ObjCounts& counts );
+
+//! receives the attributes and triangles of an obj file, in file order, cf. parse_OBJ( ).
+class ObjStream
+{
+public:
+    virtual ~ObjStream( ) {}
+    
+    //! each function returns false to stop parsing.
+    virtual bool position( const float *v )= 0;
+    virtual bool texcoord( const float *v )= 0;
+    virtual bool normal( const float *v )= 0;
+    //! 3 corners, position, texcoord, normal index triplets, 0 based or -1, indices are not checked.
+    virtual bool triangle( const int *corners )= 0;
+};
+
+//! parses an obj file in memory, sequentially, without storing it. returns -1 on error, or if stream stopped parsing.
+int parse_OBJ( const char *filename, const char *data, const size_t size, ObjStream& stream );
+
+//! welds the unique position, texcoord, normal triplets of the corners in vertices, and builds the index buffer.
+//! texcoords or normals are empty when no corner references them, missing attributes of a corner are 0.
+void weld_OBJ( const ObjData& obj, std::vector<unsigned int>& indices, 
+    std::vector<float>& positions, std::vector<float>& texcoords, std::vector<float>& normals );
+
+//! identifies the version of a source file: size, modification time and a hash of its first and last 64KB.
+struct FileStamp
+{
+    unsigned long long int size;
+    long long int mtime;
+    unsigned long long int hash;
+};
+
+//! returns -1 if the file does not exist.
+int stamp_file( const char *filename, FileStamp& stamp );
+
+//! part of a cache file.
+struct CacheSection
+{
+    unsigned int id;
+    unsigned long long int length;
+    const void *data;   //!< points in the mapped file, for read_cache( )
+};
+
+//! writes a cache file: header, section descriptors and 64 byte aligned sections.
+//! key identifies the options used to build the data. returns -1 on error.
+int write_cache( const char *filename, const FileStamp& stamp, const unsigned int key, const std::vector<CacheSection>& sections );
+
+//! maps a cache file, returns -1 if it does not exist, or was not written for this version of the source and the same key.
+//! the sections point in the mapped file, and are valid until unmap_file( ).
+int read_cache( const char *filename, const FileStamp& stamp, const unsigned int key, MappedFile& file, std::vector<CacheSection>& sections );
+
+//! reference fgets / sscanf parser, triangles with position indices only, normals use the same index (vbo format).
+//! cf. MESH_LEGACY_PARSER.
+int parse_OBJ_legacy( const char *filename, FILE *in, ObjData& obj );
+
+#endif
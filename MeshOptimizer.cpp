@@ -0,0 +1,845 @@
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+
+
+// tipsify, cf. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander, Nehab, Barczak, 2007.
+std::vector<unsigned int> optimize_vertex_cache( std::vector<unsigned int>& indices, const int vertex_count, const int cache_size )
+{
+    std::vector<unsigned int> clusters;
+    const int triangle_count= (int) indices.size() / 3;
+    if(triangle_count == 0 || vertex_count == 0)
+        return clusters;
+    
+    // vertex / triangle adjacency
+    std::vector<int> live(vertex_count, 0);
+    for(int i= 0; i < triangle_count * 3; i++)
+        live[indices[i]]++;
+    
+    std::vector<int> offsets(vertex_count +1, 0);
+    for(int v= 0; v < vertex_count; v++)
+        offsets[v +1]= offsets[v] + live[v];
+    
+    std::vector<int> adjacency(triangle_count * 3);
+    {
+        std::vector<int> next(offsets.begin(), offsets.end() -1);
+        for(int i= 0; i < triangle_count * 3; i++)
+            adjacency[next[indices[i]]++]= i / 3;
+    }
+    
+    std::vector<int> stamps(vertex_count, 0);
+    std::vector<unsigned char> emitted(triangle_count, 0);
+    std::vector<unsigned int> dead_end;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triangle_count * 3);
+    
+    int time= cache_size +1;
+    int cursor= 0;
+    int fanning= 0;
+    clusters.push_back(0);
+    while(fanning >= 0)
+    {
+        // emit the remaining triangles around the fanning vertex
+        candidates.clear();
+        for(int k= offsets[fanning]; k < offsets[fanning +1]; k++)
+        {
+            int t= adjacency[k];
+            if(emitted[t])
+                continue;
+            
+            for(int i= 0; i < 3; i++)
+            {
+                unsigned int v= indices[3*t + i];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if(time - stamps[v] > cache_size)
+                {
+                    stamps[v]= time;
+                    time++;
+                }
+            }
+            emitted[t]= 1;
+        }
+        
+        // next fanning vertex: the candidate still in the cache after emitting its triangles, and used the longest time ago
+        int next= -1;
+        int priority= -1;
+        for(int i= 0; i < (int) candidates.size(); i++)
+        {
+            unsigned int v= candidates[i];
+            if(live[v] <= 0)
+                continue;
+            
+            int p= 0;
+            if(time - stamps[v] + 2 * live[v] <= cache_size)
+                p= time - stamps[v];
+            if(p > priority)
+            {
+                priority= p;
+                next= v;
+            }
+        }
+        
+        if(next < 0)
+        {
+            // dead end, use the most recently referenced vertex with triangles left, or the next one in input order
+            while(!dead_end.empty() && next < 0)
+            {
+                unsigned int v= dead_end.back();
+                dead_end.pop_back();
+                if(live[v] > 0)
+                    next= v;
+            }
+            
+            for(; next < 0 && cursor < vertex_count; cursor++)
+                if(live[cursor] > 0)
+                    next= cursor;
+            
+            if(next >= 0 && !output.empty())
+                // the cache locality is lost, starts a new cluster
+                clusters.push_back((unsigned int) output.size() / 3);
+        }
+        
+        fanning= next;
+    }
+    
+    indices.swap(output);
+    return clusters;
+}
+
+
+struct overdraw_cluster
+{
+    unsigned int first;
+    unsigned int count;
+    float sort;
+    
+    bool operator< ( const overdraw_cluster& b ) const
+    {
+        return sort > b.sort;
+    }
+};
+
+void optimize_overdraw( std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters, const std::vector<float>& positions, 
+    const int cache_size, const float threshold )
+{
+    const unsigned int triangle_count= (unsigned int) indices.size() / 3;
+    const unsigned int vertex_count= (unsigned int) positions.size() / 3;
+    if(triangle_count == 0 || clusters.empty())
+        return;
+    
+    // split clusters at soft boundaries: where the acmr of the triangles emitted so far is low enough
+    std::vector<unsigned int> boundaries;
+    std::vector<int> stamps(vertex_count, -1);
+    int time= 0;
+    for(unsigned int c= 0; c < clusters.size(); c++)
+    {
+        unsigned int begin= clusters[c];
+        unsigned int end= (c +1 < clusters.size()) ? clusters[c +1] : triangle_count;
+        
+        // cluster acmr
+        int misses= 0;
+        for(unsigned int i= begin * 3; i < end * 3; i++)
+        {
+            unsigned int v= indices[i];
+            if(stamps[v] < 0 || time - stamps[v] >= cache_size)
+            {
+                stamps[v]= time++;
+                misses++;
+            }
+        }
+        float acmr= (float) misses / (float) (end - begin);
+        
+        // restart with a cold cache, as the start of each sub cluster
+        boundaries.push_back(begin);
+        time+= cache_size;
+        misses= 0;
+        unsigned int first= begin;
+        for(unsigned int t= begin; t < end; t++)
+        {
+            for(int i= 0; i < 3; i++)
+            {
+                unsigned int v= indices[3*t + i];
+                if(stamps[v] < 0 || time - stamps[v] >= cache_size)
+                {
+                    stamps[v]= time++;
+                    misses++;
+                }
+            }
+            
+            if(t +1 < end && (float) misses / (float) (t +1 - first) <= threshold * acmr)
+            {
+                boundaries.push_back(t +1);
+                first= t +1;
+                time+= cache_size;
+                misses= 0;
+            }
+        }
+    }
+    
+    // mesh centroid
+    double center[3]= { 0, 0, 0 };
+    for(unsigned int v= 0; v < vertex_count; v++)
+        for(int k= 0; k < 3; k++)
+            center[k]+= positions[3*v + k];
+    for(int k= 0; k < 3; k++)
+        center[k]/= std::max(1u, vertex_count);
+    
+    // sort clusters on the dot product of their area weighted normal and the direction from the mesh centroid
+    std::vector<overdraw_cluster> sorted(boundaries.size());
+    for(unsigned int c= 0; c < boundaries.size(); c++)
+    {
+        unsigned int begin= boundaries[c];
+        unsigned int end= (c +1 < boundaries.size()) ? boundaries[c +1] : triangle_count;
+        
+        float centroid[3]= { 0.f, 0.f, 0.f };
+        float normal[3]= { 0.f, 0.f, 0.f };
+        float area= 0.f;
+        for(unsigned int t= begin; t < end; t++)
+        {
+            const float *a= &positions[3 * indices[3*t]];
+            const float *b= &positions[3 * indices[3*t +1]];
+            const float *c= &positions[3 * indices[3*t +2]];
+            
+            float u[3]= { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float v[3]= { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3]= { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+            float w= sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            
+            for(int k= 0; k < 3; k++)
+            {
+                centroid[k]+= (a[k] + b[k] + c[k]) * w / 3.f;
+                normal[k]+= n[k];
+            }
+            area+= w;
+        }
+        
+        float sort= 0.f;
+        float length= sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+        if(area > 0.f && length > 0.f)
+            for(int k= 0; k < 3; k++)
+                sort+= (centroid[k] / area - (float) center[k]) * normal[k] / length;
+        
+        sorted[c].first= begin;
+        sorted[c].count= end - begin;
+        sorted[c].sort= sort;
+    }
+    
+    std::stable_sort(sorted.begin(), sorted.end());
+    
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for(unsigned int c= 0; c < sorted.size(); c++)
+        output.insert(output.end(), 
+            indices.begin() + sorted[c].first * 3, 
+            indices.begin() + (sorted[c].first + sorted[c].count) * 3);
+    
+    indices.swap(output);
+}
+
+
+static
+void remap_attribute( std::vector<float>& data, const int size, const std::vector<int>& remap, const int vertex_count )
+{
+    if(data.empty())
+        return;
+    
+    std::vector<float> tmp(vertex_count * size);
+    for(unsigned int v= 0; v < remap.size(); v++)
+    {
+        if(remap[v] < 0)
+            continue;
+        for(int k= 0; k < size; k++)
+            tmp[size*remap[v] + k]= data[size*v + k];
+    }
+    
+    data.swap(tmp);
+}
+
+int optimize_vertex_fetch( std::vector<unsigned int>& indices, 
+    std::vector<float>& positions, std::vector<float>& texcoords, std::vector<float>& normals )
+{
+    std::vector<int> remap(positions.size() / 3, -1);
+    int vertex_count= 0;
+    for(unsigned int i= 0; i < indices.size(); i++)
+    {
+        unsigned int v= indices[i];
+        if(remap[v] < 0)
+            remap[v]= vertex_count++;
+        indices[i]= remap[v];
+    }
+    
+    remap_attribute(positions, 3, remap, vertex_count);
+    remap_attribute(texcoords, 2, remap, vertex_count);
+    remap_attribute(normals, 3, remap, vertex_count);
+    return vertex_count;
+}
+
+MeshCacheStats mesh_cache_stats( const std::vector<unsigned int>& indices, const int vertex_count, 
+    const int *vertex_sizes, const int stream_count, const int cache_size, const int fetch_cache_size )
+{
+    MeshCacheStats stats= { 0.f, 0.f, 0.f };
+    const int count= (int) indices.size();
+    if(count < 3 || vertex_count == 0)
+        return stats;
+    
+    // fifo post transform cache: a vertex is in the cache if at most cache_size misses happened since it was inserted.
+    // same timestamp test for the fifo cache of 64 bytes lines, each stream is stored in its own buffer.
+    const int line_size= 64;
+    const int line_count= std::max(1, fetch_cache_size / line_size);
+    
+    std::vector<long long int> stream_lines(stream_count +1, 0);
+    int vertex_size= 0;
+    for(int s= 0; s < stream_count; s++)
+    {
+        stream_lines[s +1]= stream_lines[s] + ((long long int) vertex_count * vertex_sizes[s] + line_size -1) / line_size;
+        vertex_size+= vertex_sizes[s];
+    }
+    
+    std::vector<int> stamps(vertex_count, -1);
+    std::vector<int> line_stamps(stream_lines[stream_count], -1);
+    int misses= 0;
+    int line_misses= 0;
+    int vertices= 0;
+    for(int i= 0; i < count; i++)
+    {
+        const unsigned int v= indices[i];
+        if(stamps[v] < 0)
+            vertices++;
+        else if(misses - stamps[v] <= cache_size)
+            continue;   // transformed vertex reused, no fetch
+        
+        stamps[v]= misses++;
+        for(int s= 0; s < stream_count; s++)
+        {
+            const long long int begin= (long long int) v * vertex_sizes[s];
+            const long long int end= begin + vertex_sizes[s];
+            for(long long int l= begin / line_size; l * line_size < end; l++)
+            {
+                int& stamp= line_stamps[stream_lines[s] + l];
+                if(stamp < 0 || line_misses - stamp > line_count)
+                    stamp= line_misses++;
+            }
+        }
+    }
+    
+    stats.acmr= (float) misses / (float) (count / 3);
+    stats.atvr= (float) misses / (float) vertices;
+    if(vertex_size > 0)
+        stats.overfetch= (float) line_misses * line_size / ((float) vertices * vertex_size);
+    return stats;
+}
+
+
+//! bounding sphere and normal cone of triangles [begin, end).
+static
+gk::DebugCluster cluster_bounds( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const unsigned int begin, const unsigned int end, const unsigned int vertex_count )
+{
+    gk::DebugCluster cluster;
+    cluster.first= begin * 3;
+    cluster.count= (end - begin) * 3;
+    cluster.vertex_count= vertex_count;
+    cluster.pad[0]= 0;
+    cluster.pad[1]= 0;
+    
+    // bounding sphere, centered on the bounding box
+    float bmin[3]= { positions[3 * indices[begin * 3]], positions[3 * indices[begin * 3] +1], positions[3 * indices[begin * 3] +2] };
+    float bmax[3]= { bmin[0], bmin[1], bmin[2] };
+    for(unsigned int i= begin * 3; i < end * 3; i++)
+        for(int k= 0; k < 3; k++)
+        {
+            bmin[k]= std::min(bmin[k], positions[3 * indices[i] + k]);
+            bmax[k]= std::max(bmax[k], positions[3 * indices[i] + k]);
+        }
+    
+    float radius2= 0.f;
+    for(int k= 0; k < 3; k++)
+        cluster.center[k]= (bmin[k] + bmax[k]) * .5f;
+    for(unsigned int i= begin * 3; i < end * 3; i++)
+    {
+        const float *p= &positions[3 * indices[i]];
+        float d[3]= { p[0] - cluster.center[0], p[1] - cluster.center[1], p[2] - cluster.center[2] };
+        radius2= std::max(radius2, d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    }
+    cluster.radius= sqrtf(radius2);
+    
+    // normal cone, axis: average of the triangle normals
+    std::vector<float> normals;
+    normals.reserve((end - begin) * 3);
+    float axis[3]= { 0.f, 0.f, 0.f };
+    for(unsigned int t= begin; t < end; t++)
+    {
+        const float *a= &positions[3 * indices[3*t]];
+        const float *b= &positions[3 * indices[3*t +1]];
+        const float *c= &positions[3 * indices[3*t +2]];
+        
+        float u[3]= { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float v[3]= { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3]= { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+        float length= sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(length == 0.f)
+            continue;   // degenerate triangle, no normal
+        
+        for(int k= 0; k < 3; k++)
+        {
+            normals.push_back(n[k] / length);
+            axis[k]+= n[k] / length;
+        }
+    }
+    
+    float length= sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    if(length > 0.f)
+        for(int k= 0; k < 3; k++)
+            axis[k]/= length;
+    
+    float mindp= (length > 0.f) ? 1.f : -1.f;
+    for(unsigned int i= 0; i + 2 < normals.size(); i+= 3)
+        mindp= std::min(mindp, normals[i]*axis[0] + normals[i +1]*axis[1] + normals[i +2]*axis[2]);
+    
+    for(int k= 0; k < 3; k++)
+    {
+        cluster.cone_axis[k]= axis[k];
+        cluster.cone_apex[k]= cluster.center[k];
+    }
+    
+    if(mindp <= 0.f)
+    {
+        // normals spread over more than a hemisphere, the cluster is never back facing
+        cluster.cone_cutoff= 2.f;
+        return cluster;
+    }
+    
+    // apex: moves the center along the axis, behind all the triangle planes
+    float maxt= 0.f;
+    for(unsigned int t= begin; t < end; t++)
+    {
+        const float *a= &positions[3 * indices[3*t]];
+        const float *b= &positions[3 * indices[3*t +1]];
+        const float *c= &positions[3 * indices[3*t +2]];
+        
+        float u[3]= { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float v[3]= { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float normal[3]= { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+        float length= sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+        if(length == 0.f)
+            continue;
+        
+        float dc= 0.f;
+        float dn= 0.f;
+        for(int k= 0; k < 3; k++)
+        {
+            dc+= (cluster.center[k] - a[k]) * normal[k] / length;
+            dn+= axis[k] * normal[k] / length;
+        }
+        
+        // dn >= mindp > 0
+        maxt= std::max(maxt, dc / dn);
+    }
+    
+    for(int k= 0; k < 3; k++)
+        cluster.cone_apex[k]= cluster.center[k] - axis[k] * maxt;
+    cluster.cone_cutoff= sqrtf(1.f - mindp * mindp);
+    return cluster;
+}
+
+std::vector<gk::DebugCluster> build_clusters( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const int max_vertices, const int max_triangles )
+{
+    std::vector<gk::DebugCluster> clusters;
+    const unsigned int triangle_count= (unsigned int) indices.size() / 3;
+    if(triangle_count == 0 || max_vertices < 3 || max_triangles < 1)
+        return clusters;
+    
+    // marks[v]: last cluster using vertex v
+    std::vector<int> marks(positions.size() / 3, -1);
+    int id= 0;
+    int vertex_count= 0;
+    int count= 0;
+    unsigned int begin= 0;
+    for(unsigned int t= 0; t < triangle_count; t++)
+    {
+        unsigned int a= indices[3*t];
+        unsigned int b= indices[3*t +1];
+        unsigned int c= indices[3*t +2];
+        int added= (marks[a] != id) + (marks[b] != id && b != a) + (marks[c] != id && c != a && c != b);
+        
+        if(vertex_count + added > max_vertices || count + 1 > max_triangles)
+        {
+            // cluster is full
+            clusters.push_back( cluster_bounds(indices, positions, begin, t, vertex_count) );
+            id++;
+            begin= t;
+            vertex_count= 0;
+            count= 0;
+            added= 1 + (b != a) + (c != a && c != b);
+        }
+        
+        marks[a]= id;
+        marks[b]= id;
+        marks[c]= id;
+        vertex_count+= added;
+        count++;
+    }
+    
+    clusters.push_back( cluster_bounds(indices, positions, begin, triangle_count, vertex_count) );
+    return clusters;
+}
+
+
+//! symmetric 4x4 matrix, error of a point: p^T Q p.
+struct quadric
+{
+    float a2, ab, ac, ad;
+    float b2, bc, bd;
+    float c2, cd;
+    float d2;
+    
+    quadric( ) : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+    
+    //! adds the weighted squared distance to the plane ax + by + cz + d= 0.
+    void add_plane( const float a, const float b, const float c, const float d, const float w )
+    {
+        a2+= w * a * a; ab+= w * a * b; ac+= w * a * c; ad+= w * a * d;
+        b2+= w * b * b; bc+= w * b * c; bd+= w * b * d;
+        c2+= w * c * c; cd+= w * c * d;
+        d2+= w * d * d;
+    }
+    
+    void add( const quadric& q )
+    {
+        a2+= q.a2; ab+= q.ab; ac+= q.ac; ad+= q.ad;
+        b2+= q.b2; bc+= q.bc; bd+= q.bd;
+        c2+= q.c2; cd+= q.cd;
+        d2+= q.d2;
+    }
+    
+    float error( const float *p ) const
+    {
+        const float x= p[0];
+        const float y= p[1];
+        const float z= p[2];
+        
+        float rx= a2 * x + ab * y + ac * z + ad;
+        float ry= ab * x + b2 * y + bc * z + bd;
+        float rz= ac * x + bc * y + c2 * z + cd;
+        return fabsf(rx * x + ry * y + rz * z + ad * x + bd * y + cd * z + d2);
+    }
+};
+
+//! unnormalized normal of a triangle.
+static
+void triangle_normal( const float *a, const float *b, const float *c, float *n )
+{
+    float u[3]= { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float v[3]= { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0]= u[1]*v[2] - u[2]*v[1];
+    n[1]= u[2]*v[0] - u[0]*v[2];
+    n[2]= u[0]*v[1] - u[1]*v[0];
+}
+
+//! vertex / triangle adjacency, triangles using vertex v: adjacency[offsets[v] .. offsets[v+1]).
+static
+void build_adjacency( const std::vector<unsigned int>& indices, const unsigned int vertex_count, 
+    std::vector<unsigned int>& offsets, std::vector<unsigned int>& adjacency )
+{
+    offsets.assign(vertex_count +1, 0);
+    for(unsigned int i= 0; i < indices.size(); i++)
+        offsets[indices[i] +1]++;
+    for(unsigned int v= 0; v < vertex_count; v++)
+        offsets[v +1]+= offsets[v];
+    
+    adjacency.resize(indices.size());
+    std::vector<unsigned int> next(offsets.begin(), offsets.end() -1);
+    for(unsigned int i= 0; i < indices.size(); i++)
+        adjacency[next[indices[i]]++]= i / 3;
+}
+
+//! accumulates the area weighted plane quadrics of the triangles around each vertex.
+struct vertex_quadrics_task
+{
+    const std::vector<unsigned int>& indices;
+    const std::vector<float>& positions;
+    const std::vector<unsigned int>& offsets;
+    const std::vector<unsigned int>& adjacency;
+    std::vector<quadric>& quadrics;
+    
+    vertex_quadrics_task( const std::vector<unsigned int>& _indices, const std::vector<float>& _positions, 
+        const std::vector<unsigned int>& _offsets, const std::vector<unsigned int>& _adjacency, std::vector<quadric>& _quadrics )
+        :
+        indices(_indices), positions(_positions), offsets(_offsets), adjacency(_adjacency), quadrics(_quadrics)
+    {}
+    
+    void operator() ( const unsigned int begin, const unsigned int end ) const
+    {
+        for(unsigned int v= begin; v < end; v++)
+        {
+            quadric q;
+            for(unsigned int k= offsets[v]; k < offsets[v +1]; k++)
+            {
+                unsigned int t= adjacency[k];
+                const float *a= &positions[3 * indices[3*t]];
+                float n[3];
+                triangle_normal(a, &positions[3 * indices[3*t +1]], &positions[3 * indices[3*t +2]], n);
+                
+                float length= sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+                if(length == 0.f)
+                    continue;
+                
+                n[0]/= length;
+                n[1]/= length;
+                n[2]/= length;
+                q.add_plane(n[0], n[1], n[2], -(n[0]*a[0] + n[1]*a[1] + n[2]*a[2]), length);
+            }
+            
+            quadrics[v]= q;
+        }
+    }
+};
+
+struct collapse
+{
+    unsigned int from;
+    unsigned int to;
+    float cost;
+    
+    bool operator< ( const collapse& b ) const
+    {
+        return cost < b.cost;
+    }
+};
+
+//! evaluates the cheapest direction of each edge collapse.
+struct collapse_cost_task
+{
+    const std::vector<unsigned long long int>& edges;
+    const std::vector<float>& positions;
+    const std::vector<quadric>& quadrics;
+    const std::vector<unsigned char>& locked;
+    std::vector<collapse>& collapses;
+    
+    collapse_cost_task( const std::vector<unsigned long long int>& _edges, const std::vector<float>& _positions, 
+        const std::vector<quadric>& _quadrics, const std::vector<unsigned char>& _locked, std::vector<collapse>& _collapses )
+        :
+        edges(_edges), positions(_positions), quadrics(_quadrics), locked(_locked), collapses(_collapses)
+    {}
+    
+    void operator() ( const unsigned int begin, const unsigned int end ) const
+    {
+        const float infinity= std::numeric_limits<float>::infinity();
+        for(unsigned int i= begin; i < end; i++)
+        {
+            unsigned int a= (unsigned int) (edges[i] >> 32);
+            unsigned int b= (unsigned int) (edges[i] & 0xffffffffu);
+            
+            quadric q= quadrics[a];
+            q.add(quadrics[b]);
+            
+            float ab= locked[a] ? infinity : q.error(&positions[3*b]);     // a collapses to b
+            float ba= locked[b] ? infinity : q.error(&positions[3*a]);     // b collapses to a
+            
+            collapses[i].from= (ab <= ba) ? a : b;
+            collapses[i].to= (ab <= ba) ? b : a;
+            collapses[i].cost= std::min(ab, ba);
+        }
+    }
+};
+
+//! returns true if collapsing from to to flips a triangle, vertices are renumbered by the collapses already selected.
+static
+bool collapse_flips( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& adjacency, const std::vector<unsigned int>& remap,
+    const unsigned int from, const unsigned int to )
+{
+    for(unsigned int k= offsets[from]; k < offsets[from +1]; k++)
+    {
+        unsigned int t= adjacency[k];
+        unsigned int v[3]= { remap[indices[3*t]], remap[indices[3*t +1]], remap[indices[3*t +2]] };
+        if(v[0] == to || v[1] == to || v[2] == to)
+            continue;   // removed by the collapse
+        
+        float n[3];
+        triangle_normal(&positions[3*v[0]], &positions[3*v[1]], &positions[3*v[2]], n);
+        for(int i= 0; i < 3; i++)
+            if(v[i] == from)
+                v[i]= to;
+        
+        float m[3];
+        triangle_normal(&positions[3*v[0]], &positions[3*v[1]], &positions[3*v[2]], m);
+        if(n[0]*m[0] + n[1]*m[1] + n[2]*m[2] <= 0.f)
+            return true;
+    }
+    
+    return false;
+}
+
+std::vector<unsigned int> simplify( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const unsigned int target_count, float& error )
+{
+    error= 0.f;
+    std::vector<unsigned int> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    const unsigned int vertex_count= (unsigned int) positions.size() / 3;
+    if(result.size() <= target_count || vertex_count == 0)
+        return result;
+    
+    // normalizes positions in the unit cube, keeps quadrics in a sensible float range
+    float bmin[3]= { positions[0], positions[1], positions[2] };
+    float bmax[3]= { positions[0], positions[1], positions[2] };
+    for(unsigned int v= 0; v < vertex_count; v++)
+        for(int k= 0; k < 3; k++)
+        {
+            bmin[k]= std::min(bmin[k], positions[3*v + k]);
+            bmax[k]= std::max(bmax[k], positions[3*v + k]);
+        }
+    float extent= std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+    if(extent <= 0.f)
+        extent= 1.f;
+    
+    std::vector<float> points(vertex_count * 3);
+    for(unsigned int v= 0; v < vertex_count; v++)
+        for(int k= 0; k < 3; k++)
+            points[3*v + k]= (positions[3*v + k] - bmin[k]) / extent;
+    
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> adjacency;
+    build_adjacency(result, vertex_count, offsets, adjacency);
+    
+    std::vector<quadric> quadrics(vertex_count);
+    parallel_for(vertex_count, vertex_quadrics_task(result, points, offsets, adjacency, quadrics));
+    
+    // border vertices: on an edge used by a single triangle
+    std::vector<unsigned long long int> edges;
+    edges.reserve(result.size());
+    for(unsigned int i= 0; i < result.size(); i+= 3)
+        for(int k= 0; k < 3; k++)
+        {
+            unsigned long long int a= result[i + k];
+            unsigned long long int b= result[i + (k +1) % 3];
+            edges.push_back( (std::min(a, b) << 32) | std::max(a, b) );
+        }
+    std::sort(edges.begin(), edges.end());
+    
+    std::vector<unsigned char> locked(vertex_count, 0);
+    for(unsigned int i= 0; i < edges.size(); )
+    {
+        unsigned int n= 1;
+        while(i + n < edges.size() && edges[i + n] == edges[i])
+            n++;
+        if(n == 1)
+        {
+            locked[edges[i] >> 32]= 1;
+            locked[edges[i] & 0xffffffffu]= 1;
+        }
+        i+= n;
+    }
+    
+    std::vector<collapse> collapses;
+    std::vector<unsigned int> remap(vertex_count);
+    std::vector<unsigned char> touched(vertex_count);
+    // remaining vertex of each source vertex
+    std::vector<unsigned int> collapsed(vertex_count);
+    for(unsigned int v= 0; v < vertex_count; v++)
+        collapsed[v]= v;
+    
+    while(result.size() > target_count)
+    {
+        // unique edges of the remaining triangles
+        edges.clear();
+        for(unsigned int i= 0; i < result.size(); i+= 3)
+            for(int k= 0; k < 3; k++)
+            {
+                unsigned long long int a= result[i + k];
+                unsigned long long int b= result[i + (k +1) % 3];
+                edges.push_back( (std::min(a, b) << 32) | std::max(a, b) );
+            }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        
+        collapses.resize(edges.size());
+        parallel_for((unsigned int) edges.size(), collapse_cost_task(edges, points, quadrics, locked, collapses));
+        std::sort(collapses.begin(), collapses.end());
+        
+        build_adjacency(result, vertex_count, offsets, adjacency);
+        
+        // greedy: collapses the cheapest edges, each vertex is used by a single collapse per pass.
+        // each collapse removes 2 triangles, on a manifold.
+        unsigned int goal= std::max(1u, (unsigned int) (result.size() - target_count) / 6);
+        unsigned int count= 0;
+        for(unsigned int v= 0; v < vertex_count; v++)
+        {
+            remap[v]= v;
+            touched[v]= 0;
+        }
+        
+        for(unsigned int i= 0; i < collapses.size() && count < goal; i++)
+        {
+            const collapse& c= collapses[i];
+            if(c.cost == std::numeric_limits<float>::infinity())
+                break;
+            if(touched[c.from] || touched[c.to])
+                continue;
+            if(collapse_flips(result, points, offsets, adjacency, remap, c.from, c.to))
+                continue;
+            
+            remap[c.from]= c.to;
+            touched[c.from]= 1;
+            touched[c.to]= 1;
+            quadrics[c.to].add(quadrics[c.from]);
+            count++;
+        }
+        
+        if(count == 0)
+            break;      // nothing left to collapse
+        
+        for(unsigned int v= 0; v < vertex_count; v++)
+            collapsed[v]= remap[collapsed[v]];
+        
+        // renumber vertices, removes degenerate triangles
+        unsigned int n= 0;
+        for(unsigned int i= 0; i < result.size(); i+= 3)
+        {
+            unsigned int a= remap[result[i]];
+            unsigned int b= remap[result[i +1]];
+            unsigned int c= remap[result[i +2]];
+            if(a == b || a == c || b == c)
+                continue;
+            
+            result[n]= a;
+            result[n +1]= b;
+            result[n +2]= c;
+            n+= 3;
+        }
+        result.resize(n);
+    }
+    
+    // the quadrics are area weighted, their cost is not a distance. 
+    // measures the largest distance of the remaining vertices to the planes of the source triangles they replace.
+    float max_distance= 0.f;
+    for(unsigned int i= 0; i + 2 < indices.size(); i+= 3)
+    {
+        const float *a= &points[3 * indices[i]];
+        float n[3];
+        triangle_normal(a, &points[3 * indices[i +1]], &points[3 * indices[i +2]], n);
+        float length= sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(length == 0.f)
+            continue;
+        
+        for(int k= 0; k < 3; k++)
+        {
+            const float *p= &points[3 * collapsed[indices[i + k]]];
+            float d= fabsf(n[0] * (p[0] - a[0]) + n[1] * (p[1] - a[1]) + n[2] * (p[2] - a[2])) / length;
+            max_distance= std::max(max_distance, d);
+        }
+    }
+    
+    error= max_distance * extent;
+    return result;
+}
@@ -0,0 +1,49 @@
+
+#ifndef _MESH_OPTIMIZER_H
+#define _MESH_OPTIMIZER_H
+
+#include <vector>
+
+#include "DebugDraw.h"
+
+
+//! reorders triangles for the post transform vertex cache, tipsify [Sander, Nehab, Barczak 2007].
+//! returns the clusters found, index of the first triangle of each cluster.
+std::vector<unsigned int> optimize_vertex_cache( std::vector<unsigned int>& indices, const int vertex_count, const int cache_size= 16 );
+
+//! sorts clusters of triangles to reduce overdraw for any viewpoint, clusters facing outward first.
+//! clusters are split as long as their acmr stays below threshold * the acmr of the cluster.
+void optimize_overdraw( std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters, const std::vector<float>& positions, 
+    const int cache_size= 16, const float threshold= 1.05f );
+
+//! renumbers vertices in order of first use and reorders attributes (3 floats per position and normal, 2 per texcoord, 
+//! texcoords and normals may be empty). drops unreferenced vertices, returns the new vertex count.
+int optimize_vertex_fetch( std::vector<unsigned int>& indices, 
+    std::vector<float>& positions, std::vector<float>& texcoords, std::vector<float>& normals );
+
+//! post transform cache and vertex fetch efficiency of a triangle list.
+struct MeshCacheStats
+{
+    float acmr;         //!< transformed vertices / triangles, fifo cache, 0.5 at best, 3 at worst
+    float atvr;         //!< transformed vertices / vertices, 1 at best
+    float overfetch;    //!< bytes fetched / bytes of the vertices, cache of 64 bytes lines, 1 at best
+};
+
+//! simulates the fifo post transform cache of cache_size entries, and the vertex fetches of the transformed vertices.
+//! vertex_sizes are the sizes in bytes of the stream_count attributes, each stored in its own buffer.
+MeshCacheStats mesh_cache_stats( const std::vector<unsigned int>& indices, const int vertex_count, 
+    const int *vertex_sizes, const int stream_count, const int cache_size= 16, const int fetch_cache_size= 16384 );
+
+//! simplifies triangles with a quadric error metric [Garland, Heckbert 1997], until at most target_count indices remain. 
+//! edges collapse to one of their vertices, the simplified triangles use the same vertices, border vertices are kept.
+//! returns the simplified indices, error is the largest distance of the remaining vertices to the planes of the source triangles 
+//! they replace, in position units.
+std::vector<unsigned int> simplify( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const unsigned int target_count, float& error );
+
+//! partitions triangles in clusters of at most max_vertices and max_triangles, following the triangle order.
+//! computes a bounding sphere and a normal cone for each cluster.
+std::vector<gk::DebugCluster> build_clusters( const std::vector<unsigned int>& indices, const std::vector<float>& positions, 
+    const int max_vertices= 64, const int max_triangles= 124 );
+
+#endif
@@ -0,0 +1,118 @@
+
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "Parallel.h"
+
+
+unsigned int worker_count( )
+{
+    static const unsigned int count= std::max(1u, std::min(64u, std::thread::hardware_concurrency()));
+    return count;
+}
+
+//! worker threads, waiting for the next loop.
+struct WorkerPool
+{
+    std::vector<std::thread> threads;
+    std::atomic<bool> busy;     //!< set while a loop runs on the workers
+    std::mutex lock;    //!< protects the loop parameters and the counters below
+    std::condition_variable start;
+    std::condition_variable done;
+    unsigned int generation;    //!< incremented for each loop
+    unsigned int active;        //!< workers still running the current loop
+    bool stop;
+    
+    // current loop, [0, n) is split in parts, taken in turn by the threads
+    void (*function)( const void *, const unsigned int, const unsigned int );
+    const void *task;
+    unsigned int n;
+    unsigned int parts;
+    std::atomic<unsigned int> next;
+    
+    WorkerPool( ) : threads(), busy(false), lock(), start(), done(), generation(0), active(0), stop(false), 
+        function(NULL), task(NULL), n(0), parts(0), next(0)
+    {
+        for(unsigned int i= 1; i < worker_count(); i++)
+            threads.push_back( std::thread(&WorkerPool::worker, this) );
+    }
+    
+    ~WorkerPool( )
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop= true;
+        }
+        start.notify_all();
+        for(unsigned int i= 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+    
+    void run_parts( )
+    {
+        for(unsigned int p= next++; p < parts; p= next++)
+            function(task, (unsigned int) ((unsigned long long int) n * p / parts), (unsigned int) ((unsigned long long int) n * (p +1) / parts));
+    }
+    
+    void worker( )
+    {
+        unsigned int seen= 0;
+        std::unique_lock<std::mutex> guard(lock);
+        for(;;)
+        {
+            while(stop == false && generation == seen)
+                start.wait(guard);
+            if(stop)
+                return;
+            
+            seen= generation;
+            guard.unlock();
+            run_parts();
+            guard.lock();
+            
+            if(--active == 0)
+                done.notify_one();
+        }
+    }
+    
+    void run( const unsigned int _n, void (*_function)( const void *, const unsigned int, const unsigned int ), const void *_task )
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            function= _function;
+            task= _task;
+            n= _n;
+            // a few parts per thread, to balance the work
+            parts= std::min(_n, 4 * worker_count());
+            next= 0;
+            active= (unsigned int) threads.size();
+            generation++;
+        }
+        start.notify_all();
+        
+        run_parts();
+        
+        std::unique_lock<std::mutex> guard(lock);
+        while(active > 0)
+            done.wait(guard);
+    }
+};
+
+void parallel_run( const unsigned int n, void (*function)( const void *task, const unsigned int begin, const unsigned int end ), const void *task )
+{
+    static WorkerPool pool;
+    
+    // the workers are used by an other loop, or by the loop calling this one
+    if(pool.busy.exchange(true))
+    {
+        function(task, 0, n);
+        return;
+    }
+    
+    pool.run(n, function, task);
+    pool.busy= false;
+}
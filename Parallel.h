@@ -0,0 +1,33 @@
+
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+
+//! number of threads used by parallel_for( ): hardware threads, at most 64.
+unsigned int worker_count( );
+
+//! runs function(task, begin, end) on ranges of [0, n), on the calling thread and the worker threads.
+//! the workers are created once, and reused. a single loop runs on the workers at a time, 
+//! a concurrent or nested loop runs on its calling thread.
+void parallel_run( const unsigned int n, void (*function)( const void *task, const unsigned int begin, const unsigned int end ), const void *task );
+
+template < class Task >
+void run_task( const void *task, const unsigned int begin, const unsigned int end )
+{
+    (*(const Task *) task)(begin, end);
+}
+
+//! splits [0, n) in ranges processed in parallel by task(begin, end), returns once all ranges are processed.
+//! runs task(0, n) on the calling thread when n < grain.
+template < class Task >
+void parallel_for( const unsigned int n, const Task& task, const unsigned int grain= 16384 )
+{
+    if(n == 0)
+        return;
+    if(n < grain || worker_count() == 1)
+        task(0, n);
+    else
+        parallel_run(n, run_task<Task>, &task);
+}
+
+#endif
@@ -12,27 +12,588 @@
 #include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <vector>
 
 #include "Transform.h"
+#include "Parallel.h"
+
+// GK_SSE est defini par Geometry.h
+// avx kernels are compiled for the avx target, and selected at run time
+#if defined(GK_SSE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GK_AVX 1
+#include <immintrin.h>
+#endif
 
 namespace gk {
 
-// Matrix4x4 Methods Definitions
-Matrix4x4::Matrix4x4( const float mat[4][4] )
+// produits de matrices, les operations sont faites dans le meme ordre que la version scalaire, sans fma.
+#ifndef GK_SSE
+static
+void mul_scalar( const float (*a)[4], const float (*b)[4], float (*r)[4] )
 {
-    memcpy(m, mat, sizeof(float[16]));
+    for(int i = 0; i < 4; ++i)
+        for(int j = 0; j < 4; ++j)
+            r[i][j] = 
+                a[i][0] * b[0][j] +
+                a[i][1] * b[1][j] +
+                a[i][2] * b[2][j] +
+                a[i][3] * b[3][j];
+}
+#endif
+
+#ifdef GK_SSE
+static
+void mul_sse( const float (*a)[4], const float (*b)[4], float (*r)[4] )
+{
+    const __m128 b0= _mm_load_ps(b[0]);
+    const __m128 b1= _mm_load_ps(b[1]);
+    const __m128 b2= _mm_load_ps(b[2]);
+    const __m128 b3= _mm_load_ps(b[3]);
+    
+    for(int i= 0; i < 4; i++)
+    {
+        // ligne i de r = a[i][0] * b0 + a[i][1] * b1 + a[i][2] * b2 + a[i][3] * b3
+        __m128 row= _mm_mul_ps(_mm_set1_ps(a[i][0]), b0);
+        row= _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][1]), b1));
+        row= _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][2]), b2));
+        row= _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][3]), b3));
+        _mm_store_ps(r[i], row);
+    }
+}
+#endif
+
+#ifdef GK_AVX
+//! 2 lignes de a a la fois.
+__attribute__((target("avx"))) static
+void mul_avx( const float (*a)[4], const float (*b)[4], float (*r)[4] )
+{
+    const __m256 b0= _mm256_broadcast_ps((const __m128 *) b[0]);
+    const __m256 b1= _mm256_broadcast_ps((const __m128 *) b[1]);
+    const __m256 b2= _mm256_broadcast_ps((const __m128 *) b[2]);
+    const __m256 b3= _mm256_broadcast_ps((const __m128 *) b[3]);
+    
+    for(int i= 0; i < 4; i+= 2)
+    {
+        __m256 a0= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a[i][0])), _mm_set1_ps(a[i+1][0]), 1);
+        __m256 a1= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a[i][1])), _mm_set1_ps(a[i+1][1]), 1);
+        __m256 a2= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a[i][2])), _mm_set1_ps(a[i+1][2]), 1);
+        __m256 a3= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a[i][3])), _mm_set1_ps(a[i+1][3]), 1);
+        
+        __m256 rows= _mm256_mul_ps(a0, b0);
+        rows= _mm256_add_ps(rows, _mm256_mul_ps(a1, b1));
+        rows= _mm256_add_ps(rows, _mm256_mul_ps(a2, b2));
+        rows= _mm256_add_ps(rows, _mm256_mul_ps(a3, b3));
+        _mm256_storeu_ps(r[i], rows);    // r n'est aligne que sur 16 octets
+    }
+}
+#endif
+
+// transformations de points.
+static
+void transform_scalar( const Matrix4x4& m, const Point *points, Point *result, const int n )
+{
+    for(int i= 0; i < n; i++)
+        result[i]= Matrix4x4::Transform(m, points[i]);
+}
+
+#ifdef GK_SSE
+//! separe les composantes de 4 points consecutifs : a= x0 y0 z0 x1, b= y1 z1 x2 y2, c= z2 x3 y3 z3.
+static inline
+void deinterleave_sse( const __m128 a, const __m128 b, const __m128 c, __m128& x, __m128& y, __m128& z )
+{
+    x= _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    y= _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    z= _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+//! operation inverse de deinterleave_sse( ).
+static inline
+void interleave_sse( const __m128 x, const __m128 y, const __m128 z, __m128& a, __m128& b, __m128& c )
+{
+    const __m128 xy0= _mm_unpacklo_ps(x, y);    // x0 y0 x1 y1
+    const __m128 xy1= _mm_unpackhi_ps(x, y);    // x2 y2 x3 y3
+    a= _mm_shuffle_ps(xy0, _mm_shuffle_ps(z, xy0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+    b= _mm_shuffle_ps(_mm_shuffle_ps(xy0, z, _MM_SHUFFLE(1, 1, 3, 3)), xy1, _MM_SHUFFLE(1, 0, 2, 0));
+    c= _mm_shuffle_ps(_mm_shuffle_ps(z, xy1, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(xy1, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static_assert(sizeof(Point) == sizeof(float [3]), "Point: x y z");
+
+//! 4 points a la fois, transposes en x, y, z, cf. soa_sse( ).
+static
+void transform_sse( const Matrix4x4& m, const Point *points, Point *result, const int n )
+{
+    const __m128 one= _mm_set1_ps(1.f);
+    const float *p= (const float *) points;
+    float *r= (float *) result;
+    int i= 0;
+    for(; i +3 < n; i+= 4)
+    {
+        __m128 px, py, pz;
+        deinterleave_sse(_mm_loadu_ps(p + 3*i), _mm_loadu_ps(p + 3*i + 4), _mm_loadu_ps(p + 3*i + 8), px, py, pz);
+        
+        __m128 t[4];
+        for(int k= 0; k < 4; k++)
+        {
+            t[k]= _mm_mul_ps(_mm_set1_ps(m.m[k][0]), px);
+            t[k]= _mm_add_ps(t[k], _mm_mul_ps(_mm_set1_ps(m.m[k][1]), py));
+            t[k]= _mm_add_ps(t[k], _mm_mul_ps(_mm_set1_ps(m.m[k][2]), pz));
+            t[k]= _mm_add_ps(t[k], _mm_set1_ps(m.m[k][3]));
+        }
+        
+        assert( _mm_movemask_ps(_mm_cmpeq_ps(t[3], _mm_setzero_ps())) == 0 );
+        // comme Point::operator/, sauf si w == 1
+        const __m128 affine= _mm_cmpeq_ps(t[3], one);
+        const __m128 inv= _mm_or_ps(_mm_and_ps(affine, one), _mm_andnot_ps(affine, _mm_div_ps(one, t[3])));
+        
+        __m128 a, b, c;
+        interleave_sse(_mm_mul_ps(t[0], inv), _mm_mul_ps(t[1], inv), _mm_mul_ps(t[2], inv), a, b, c);
+        _mm_storeu_ps(r + 3*i, a);
+        _mm_storeu_ps(r + 3*i + 4, b);
+        _mm_storeu_ps(r + 3*i + 8, c);
+    }
+    
+    if(i < n)
+        transform_scalar(m, points + i, result + i, n - i);
+}
+#endif
+
+#ifdef GK_AVX
+//! 8 points a la fois : 2 groupes de 4 points, un par moitie des registres, memes permutations que transform_sse( ).
+__attribute__((target("avx"))) static
+void transform_avx( const Matrix4x4& m, const Point *points, Point *result, const int n )
+{
+    const __m256 one= _mm256_set1_ps(1.f);
+    const float *p= (const float *) points;
+    float *r= (float *) result;
+    int i= 0;
+    for(; i +7 < n; i+= 8)
+    {
+        // a= x0 y0 z0 x1 | x4 y4 z4 x5, etc.
+        const __m256 a= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 3*i)), _mm_loadu_ps(p + 3*i + 12), 1);
+        const __m256 b= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 3*i + 4)), _mm_loadu_ps(p + 3*i + 16), 1);
+        const __m256 c= _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 3*i + 8)), _mm_loadu_ps(p + 3*i + 20), 1);
+        
+        const __m256 px= _mm256_shuffle_ps(a, _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+        const __m256 py= _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 pz= _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        
+        __m256 t[4];
+        for(int k= 0; k < 4; k++)
+        {
+            t[k]= _mm256_mul_ps(_mm256_set1_ps(m.m[k][0]), px);
+            t[k]= _mm256_add_ps(t[k], _mm256_mul_ps(_mm256_set1_ps(m.m[k][1]), py));
+            t[k]= _mm256_add_ps(t[k], _mm256_mul_ps(_mm256_set1_ps(m.m[k][2]), pz));
+            t[k]= _mm256_add_ps(t[k], _mm256_set1_ps(m.m[k][3]));
+        }
+        
+        assert( _mm256_movemask_ps(_mm256_cmp_ps(t[3], _mm256_setzero_ps(), _CMP_EQ_OQ)) == 0 );
+        const __m256 affine= _mm256_cmp_ps(t[3], one, _CMP_EQ_OQ);
+        const __m256 inv= _mm256_blendv_ps(_mm256_div_ps(one, t[3]), one, affine);
+        const __m256 x= _mm256_mul_ps(t[0], inv);
+        const __m256 y= _mm256_mul_ps(t[1], inv);
+        const __m256 z= _mm256_mul_ps(t[2], inv);
+        
+        const __m256 xy0= _mm256_unpacklo_ps(x, y);
+        const __m256 xy1= _mm256_unpackhi_ps(x, y);
+        const __m256 ra= _mm256_shuffle_ps(xy0, _mm256_shuffle_ps(z, xy0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+        const __m256 rb= _mm256_shuffle_ps(_mm256_shuffle_ps(xy0, z, _MM_SHUFFLE(1, 1, 3, 3)), xy1, _MM_SHUFFLE(1, 0, 2, 0));
+        const __m256 rc= _mm256_shuffle_ps(_mm256_shuffle_ps(z, xy1, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_shuffle_ps(xy1, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_ps(r + 3*i, _mm256_castps256_ps128(ra));
+        _mm_storeu_ps(r + 3*i + 4, _mm256_castps256_ps128(rb));
+        _mm_storeu_ps(r + 3*i + 8, _mm256_castps256_ps128(rc));
+        _mm_storeu_ps(r + 3*i + 12, _mm256_extractf128_ps(ra, 1));
+        _mm_storeu_ps(r + 3*i + 16, _mm256_extractf128_ps(rb, 1));
+        _mm_storeu_ps(r + 3*i + 20, _mm256_extractf128_ps(rc, 1));
+    }
+    
+    // evite la penalite de transition avx / sse
+    _mm256_zeroupper();
+    if(i < n)
+        transform_sse(m, points + i, result + i, n - i);
+}
+#endif
+
+typedef void (*mul_function)( const float (*)[4], const float (*)[4], float (*)[4] );
+typedef void (*transform_function)( const Matrix4x4&, const Point *, Point *, const int );
+
+//! selectionne les versions sse / avx, une seule fois.
+static
+bool cpu_supports_avx( )
+{
+#ifdef GK_AVX
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#else
+    return false;
+#endif
+}
+
+static
+mul_function select_mul( )
+{
+#ifdef GK_AVX
+    if(cpu_supports_avx())
+        return mul_avx;
+#endif
+#ifdef GK_SSE
+    return mul_sse;
+#else
+    return mul_scalar;
+#endif
+}
+
+static
+transform_function select_transform( )
+{
+#ifdef GK_AVX
+    if(cpu_supports_avx())
+        return transform_avx;
+#endif
+#ifdef GK_SSE
+    return transform_sse;
+#else
+    return transform_scalar;
+#endif
 }
 
-Matrix4x4::Matrix4x4(
-    float t00, float t01, float t02, float t03,
-    float t10, float t11, float t12, float t13,
-    float t20, float t21, float t22, float t23,
-    float t30, float t31, float t32, float t33)
+Matrix4x4 Matrix4x4::Mul( const Matrix4x4 &m1, const Matrix4x4 &m2 )
 {
-    m[0][0] = t00; m[0][1] = t01; m[0][2] = t02; m[0][3] = t03;
-    m[1][0] = t10; m[1][1] = t11; m[1][2] = t12; m[1][3] = t13;
-    m[2][0] = t20; m[2][1] = t21; m[2][2] = t22; m[2][3] = t23;
-    m[3][0] = t30; m[3][1] = t31; m[3][2] = t32; m[3][3] = t33;
+    static const mul_function mul= select_mul();
+    
+    Matrix4x4 r;
+    mul(m1.m, m2.m, r.m);
+    return r;
+}
+
+void Matrix4x4::Transform( const Matrix4x4& m, const Point *points, Point *result, const int n )
+{
+    static const transform_function transform= select_transform();
+    transform(m, points, result, n);
+}
+
+
+// transformations de tableaux de vecteurs : v= c0 * x + c1 * y + c2 * z
+#ifndef GK_SSE
+static
+void vectors_scalar( const Matrix4x4& m, const float *vectors, float *result, const int n )
+{
+    for(int i= 0; i < n; i++)
+    {
+        const float x= vectors[3*i];
+        const float y= vectors[3*i +1];
+        const float z= vectors[3*i +2];
+        result[3*i]= m.m[0][0] * x + m.m[0][1] * y + m.m[0][2] * z;
+        result[3*i +1]= m.m[1][0] * x + m.m[1][1] * y + m.m[1][2] * z;
+        result[3*i +2]= m.m[2][0] * x + m.m[2][1] * y + m.m[2][2] * z;
+    }
+}
+#endif
+
+#ifdef GK_SSE
+static
+void vectors_sse( const Matrix4x4& m, const float *vectors, float *result, const int n )
+{
+    __m128 c0= _mm_load_ps(m.m[0]);
+    __m128 c1= _mm_load_ps(m.m[1]);
+    __m128 c2= _mm_load_ps(m.m[2]);
+    __m128 c3= _mm_load_ps(m.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    
+    alignas(16) float v[4];
+    for(int i= 0; i < n; i++)
+    {
+        __m128 r= _mm_mul_ps(c0, _mm_set1_ps(vectors[3*i]));
+        r= _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(vectors[3*i +1])));
+        r= _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(vectors[3*i +2])));
+        _mm_store_ps(v, r);
+        result[3*i]= v[0];
+        result[3*i +1]= v[1];
+        result[3*i +2]= v[2];
+    }
+}
+#endif
+
+// projection de points, sans division : x y z w
+static
+void clip_scalar( const Matrix4x4& m, const float *points, float *result, const int n )
+{
+    for(int i= 0; i < n; i++)
+    {
+        const float x= points[3*i];
+        const float y= points[3*i +1];
+        const float z= points[3*i +2];
+        for(int k= 0; k < 4; k++)
+            result[4*i + k]= m.m[k][0] * x + m.m[k][1] * y + m.m[k][2] * z + m.m[k][3];
+    }
+}
+
+#ifdef GK_SSE
+static
+void clip_sse( const Matrix4x4& m, const float *points, float *result, const int n )
+{
+    __m128 c0= _mm_load_ps(m.m[0]);
+    __m128 c1= _mm_load_ps(m.m[1]);
+    __m128 c2= _mm_load_ps(m.m[2]);
+    __m128 c3= _mm_load_ps(m.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    
+    for(int i= 0; i < n; i++)
+    {
+        __m128 r= _mm_mul_ps(c0, _mm_set1_ps(points[3*i]));
+        r= _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(points[3*i +1])));
+        r= _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(points[3*i +2])));
+        r= _mm_add_ps(r, c3);
+        _mm_storeu_ps(result + 4*i, r);
+    }
+}
+#endif
+
+#ifdef GK_AVX
+//! 2 points a la fois.
+__attribute__((target("avx"))) static
+void clip_avx( const Matrix4x4& m, const float *points, float *result, const int n )
+{
+    __m128 c0= _mm_load_ps(m.m[0]);
+    __m128 c1= _mm_load_ps(m.m[1]);
+    __m128 c2= _mm_load_ps(m.m[2]);
+    __m128 c3= _mm_load_ps(m.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    
+    const __m256 col0= _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+    const __m256 col1= _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+    const __m256 col2= _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+    const __m256 col3= _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+    
+    int i= 0;
+    for(; i +1 < n; i+= 2)
+    {
+        const float *a= points + 3*i;
+        const float *b= a + 3;
+        __m256 r= _mm256_mul_ps(col0, _mm256_setr_ps(a[0], a[0], a[0], a[0], b[0], b[0], b[0], b[0]));
+        r= _mm256_add_ps(r, _mm256_mul_ps(col1, _mm256_setr_ps(a[1], a[1], a[1], a[1], b[1], b[1], b[1], b[1])));
+        r= _mm256_add_ps(r, _mm256_mul_ps(col2, _mm256_setr_ps(a[2], a[2], a[2], a[2], b[2], b[2], b[2], b[2])));
+        r= _mm256_add_ps(r, col3);
+        _mm256_storeu_ps(result + 4*i, r);
+    }
+    
+    if(i < n)
+        clip_scalar(m, points + 3*i, result + 4*i, n - i);
+    _mm256_zeroupper();
+}
+#endif
+
+// points en 3 tableaux (SoA), une composante de plusieurs points a la fois.
+static
+void soa_scalar( const Matrix4x4& m, const float *x, const float *y, const float *z, float *rx, float *ry, float *rz, const int n )
+{
+    for(int i= 0; i < n; i++)
+    {
+        Point p= Matrix4x4::Transform(m, Point(x[i], y[i], z[i]));
+        rx[i]= p.x;
+        ry[i]= p.y;
+        rz[i]= p.z;
+    }
+}
+
+#ifdef GK_SSE
+//! 4 points a la fois.
+static
+void soa_sse( const Matrix4x4& m, const float *x, const float *y, const float *z, float *rx, float *ry, float *rz, const int n )
+{
+    const __m128 one= _mm_set1_ps(1.f);
+    int i= 0;
+    for(; i +3 < n; i+= 4)
+    {
+        const __m128 px= _mm_loadu_ps(x + i);
+        const __m128 py= _mm_loadu_ps(y + i);
+        const __m128 pz= _mm_loadu_ps(z + i);
+        
+        __m128 r[4];
+        for(int k= 0; k < 4; k++)
+        {
+            r[k]= _mm_mul_ps(_mm_set1_ps(m.m[k][0]), px);
+            r[k]= _mm_add_ps(r[k], _mm_mul_ps(_mm_set1_ps(m.m[k][1]), py));
+            r[k]= _mm_add_ps(r[k], _mm_mul_ps(_mm_set1_ps(m.m[k][2]), pz));
+            r[k]= _mm_add_ps(r[k], _mm_set1_ps(m.m[k][3]));
+        }
+        
+        // comme Point::operator/, sauf si w == 1
+        const __m128 affine= _mm_cmpeq_ps(r[3], one);
+        const __m128 inv= _mm_or_ps(_mm_and_ps(affine, one), _mm_andnot_ps(affine, _mm_div_ps(one, r[3])));
+        _mm_storeu_ps(rx + i, _mm_mul_ps(r[0], inv));
+        _mm_storeu_ps(ry + i, _mm_mul_ps(r[1], inv));
+        _mm_storeu_ps(rz + i, _mm_mul_ps(r[2], inv));
+    }
+    
+    if(i < n)
+        soa_scalar(m, x + i, y + i, z + i, rx + i, ry + i, rz + i, n - i);
+}
+#endif
+
+#ifdef GK_AVX
+//! 8 points a la fois.
+__attribute__((target("avx"))) static
+void soa_avx( const Matrix4x4& m, const float *x, const float *y, const float *z, float *rx, float *ry, float *rz, const int n )
+{
+    const __m256 one= _mm256_set1_ps(1.f);
+    int i= 0;
+    for(; i +7 < n; i+= 8)
+    {
+        const __m256 px= _mm256_loadu_ps(x + i);
+        const __m256 py= _mm256_loadu_ps(y + i);
+        const __m256 pz= _mm256_loadu_ps(z + i);
+        
+        __m256 r[4];
+        for(int k= 0; k < 4; k++)
+        {
+            r[k]= _mm256_mul_ps(_mm256_set1_ps(m.m[k][0]), px);
+            r[k]= _mm256_add_ps(r[k], _mm256_mul_ps(_mm256_set1_ps(m.m[k][1]), py));
+            r[k]= _mm256_add_ps(r[k], _mm256_mul_ps(_mm256_set1_ps(m.m[k][2]), pz));
+            r[k]= _mm256_add_ps(r[k], _mm256_set1_ps(m.m[k][3]));
+        }
+        
+        const __m256 affine= _mm256_cmp_ps(r[3], one, _CMP_EQ_OQ);
+        const __m256 inv= _mm256_blendv_ps(_mm256_div_ps(one, r[3]), one, affine);
+        _mm256_storeu_ps(rx + i, _mm256_mul_ps(r[0], inv));
+        _mm256_storeu_ps(ry + i, _mm256_mul_ps(r[1], inv));
+        _mm256_storeu_ps(rz + i, _mm256_mul_ps(r[2], inv));
+    }
+    
+    if(i < n)
+        soa_scalar(m, x + i, y + i, z + i, rx + i, ry + i, rz + i, n - i);
+    _mm256_zeroupper();
+}
+#endif
+
+typedef void (*array_function)( const Matrix4x4&, const float *, float *, const int );
+typedef void (*soa_function)( const Matrix4x4&, const float *, const float *, const float *, float *, float *, float *, const int );
+
+static
+array_function select_vectors( )
+{
+#ifdef GK_SSE
+    return vectors_sse;
+#else
+    return vectors_scalar;
+#endif
+}
+
+static
+array_function select_clip( )
+{
+#ifdef GK_AVX
+    if(cpu_supports_avx())
+        return clip_avx;
+#endif
+#ifdef GK_SSE
+    return clip_sse;
+#else
+    return clip_scalar;
+#endif
+}
+
+static
+soa_function select_soa( )
+{
+#ifdef GK_AVX
+    if(cpu_supports_avx())
+        return soa_avx;
+#endif
+#ifdef GK_SSE
+    return soa_sse;
+#else
+    return soa_scalar;
+#endif
+}
+
+//! transforme les points d'un tableau AoS, cf. Matrix4x4::Transform( ).
+static
+void points_array( const Matrix4x4& m, const float *points, float *result, const int n )
+{
+    Matrix4x4::Transform(m, (const Point *) points, (Point *) result, n);
+}
+
+//! execute task(begin, end) sur des parties de [0, n), en parallele si necessaire.
+template < typename Task >
+static
+void parallel_batch( const int n, const bool parallel, const Task& task )
+{
+    if(parallel)
+        parallel_for((unsigned int) n, task, 65536);
+    else
+        task(0, n);
+}
+
+struct array_task
+{
+    array_function function;
+    const Matrix4x4& m;
+    const float *data;
+    float *result;
+    int result_size;    //!< floats par element du resultat
+    
+    array_task( array_function _function, const Matrix4x4& _m, const float *_data, float *_result, const int _size )
+        : function(_function), m(_m), data(_data), result(_result), result_size(_size) {}
+    
+    void operator()( const int begin, const int end ) const
+    {
+        function(m, data + 3*begin, result + result_size*begin, end - begin);
+    }
+};
+
+struct soa_task
+{
+    soa_function function;
+    const Matrix4x4& m;
+    const float *x, *y, *z;
+    float *rx, *ry, *rz;
+    
+    soa_task( soa_function _function, const Matrix4x4& _m, const float *_x, const float *_y, const float *_z, float *_rx, float *_ry, float *_rz )
+        : function(_function), m(_m), x(_x), y(_y), z(_z), rx(_rx), ry(_ry), rz(_rz) {}
+    
+    void operator()( const int begin, const int end ) const
+    {
+        function(m, x + begin, y + begin, z + begin, rx + begin, ry + begin, rz + begin, end - begin);
+    }
+};
+
+void Transform::transformPoints( const float *points, float *result, const int n, const bool parallel ) const
+{
+    parallel_batch(n, parallel, array_task(points_array, m, points, result, 3));
+}
+
+void Transform::transformVectors( const float *vectors, float *result, const int n, const bool parallel ) const
+{
+    static const array_function function= select_vectors();
+    parallel_batch(n, parallel, array_task(function, m, vectors, result, 3));
+}
+
+void Transform::transformNormals( const float *normals, float *result, const int n, const bool parallel ) const
+{
+    // inverse transposee, calculee avant de repartir le tableau
+    static const array_function function= select_vectors();
+    const Matrix4x4 normal= normalMatrix();
+    parallel_batch(n, parallel, array_task(function, normal, normals, result, 3));
+}
+
+void Transform::transformPoints( const float *x, const float *y, const float *z, float *rx, float *ry, float *rz, 
+    const int n, const bool parallel ) const
+{
+    static const soa_function function= select_soa();
+    parallel_batch(n, parallel, soa_task(function, m, x, y, z, rx, ry, rz));
+}
+
+void Transform::transformClip( const float *points, float *result, const int n, const bool parallel ) const
+{
+    static const array_function function= select_clip();
+    parallel_batch(n, parallel, array_task(function, m, points, result, 4));
+}
+
+// Matrix4x4 Methods Definitions
+Matrix4x4::Matrix4x4( const float mat[4][4] )
+{
+    memcpy(m, mat, sizeof(float[16]));
 }
 
 Matrix4x4 Matrix4x4::Transpose() const 
@@ -115,61 +676,6 @@ Matrix4x4 Matrix4x4::getInverse() const
 
 
 // Transform Method Definitions
-//! renvoie la transformation associee a une translatation du vecteur delta.
-Transform Translate( const Vector &delta )
-{
-    Matrix4x4 m(
-        1, 0, 0, delta.x,
-        0, 1, 0, delta.y,
-        0, 0, 1, delta.z,
-        0, 0, 0,       1 );
-    
-    Matrix4x4 minv( 
-        1, 0, 0, -delta.x,
-        0, 1, 0, -delta.y,
-        0, 0, 1, -delta.z,
-        0, 0, 0,        1 );
-    
-    return Transform( m, minv );
-}
-
-//! renvoie la transformation associee au changement d'echelle (x, y, z).
-Transform Scale( float x, float y, float z )
-{
-    Matrix4x4 m(
-        x, 0, 0, 0,
-        0, y, 0, 0,
-        0, 0, z, 0,
-        0, 0, 0, 1 );
-    
-    Matrix4x4 minv(
-        1.f / x,       0,       0, 0,
-              0, 1.f / y,       0, 0,
-              0,       0, 1.f / z, 0,
-              0,       0,       0, 1 );
-    
-    return Transform( m, minv );
-}
-
-//! renvoie la transformation associee au changement d'echelle (v, v, v).
-Transform Scale( float v )
-{
-    Matrix4x4 m(
-        v, 0, 0, 0,
-        0, v, 0, 0,
-        0, 0, v, 0,
-        0, 0, 0, 1 );
-    
-    Matrix4x4 minv(
-        1.f / v,       0,       0, 0,
-              0, 1.f / v,       0, 0,
-              0,       0, 1.f / v, 0,
-              0,       0,       0, 1 );
-    
-    return Transform( m, minv );
-}
-
-
 //! renvoie la transformation associee a une rotation autour de l'axe X, angle est en degres.
 Transform RotateX( float angle )
 {
@@ -300,33 +806,84 @@ Transform LookAt( const Point &pos, const Point &look, const Vector &up )
     m[3][3] = 1.f;
 
     Matrix4x4 camToWorld(m);
-    return Transform( camToWorld.getInverse(), camToWorld );
+    
+    // inverse d'une rotation + translation : transposee de la rotation, et translation -R^T pos
+    Matrix4x4 worldToCam(
+        m[0][0], m[1][0], m[2][0], -(m[0][0] * pos.x + m[1][0] * pos.y + m[2][0] * pos.z),
+        m[0][1], m[1][1], m[2][1], -(m[0][1] * pos.x + m[1][1] * pos.y + m[2][1] * pos.z),
+        m[0][2], m[1][2], m[2][2], -(m[0][2] * pos.x + m[1][2] * pos.y + m[2][2] * pos.z),
+        0.f, 0.f, 0.f, 1.f );
+    
+    return Transform( worldToCam, camToWorld );
 }
 
-#if 0 // inline
+//! transformation affine d'une boite, cf. "Transforming Axis-Aligned Bounding Boxes", J. Arvo, Graphics Gems, 1990.
+//! chaque composante du resultat est la somme des min / max des contributions de chaque axe, sans transformer les 8 sommets.
 BBox Transform::operator()( const BBox &b ) const
 {
-    const Transform &M = *this;
+    if(b.IsEmpty())
+        return BBox();
     
-    BBox ret( M( Point( b.pMin.x, b.pMin.y, b.pMin.z ) ) );
-    ret = Union( ret, M( Point( b.pMax.x, b.pMin.y, b.pMin.z ) ) );
-    ret = Union( ret, M( Point( b.pMin.x, b.pMax.y, b.pMin.z ) ) );
-    ret = Union( ret, M( Point( b.pMin.x, b.pMin.y, b.pMax.z ) ) );
-    ret = Union( ret, M( Point( b.pMin.x, b.pMax.y, b.pMax.z ) ) );
-    ret = Union( ret, M( Point( b.pMax.x, b.pMax.y, b.pMin.z ) ) );
-    ret = Union( ret, M( Point( b.pMax.x, b.pMin.y, b.pMax.z ) ) );
-    ret = Union( ret, M( Point( b.pMax.x, b.pMax.y, b.pMax.z ) ) );
+    if(m.m[3][0] != 0.f || m.m[3][1] != 0.f || m.m[3][2] != 0.f || m.m[3][3] != 1.f)
+    {
+        // transformation projective : transforme les 8 sommets
+        Point corners[8];
+        for(int i= 0; i < 8; i++)
+            corners[i]= Point( (i & 1) ? b.pMax.x : b.pMin.x, (i & 2) ? b.pMax.y : b.pMin.y, (i & 4) ? b.pMax.z : b.pMin.z );
+        Matrix4x4::Transform(m, corners, corners, 8);
+        return BBox( &corners[0].x, 8 );
+    }
+    
+    BBox ret;
+#ifdef GK_SSE
+    __m128 c0= _mm_load_ps(m.m[0]);
+    __m128 c1= _mm_load_ps(m.m[1]);
+    __m128 c2= _mm_load_ps(m.m[2]);
+    __m128 c3= _mm_load_ps(m.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    
+    const __m128 columns[3]= { c0, c1, c2 };
+    __m128 rmin= c3;
+    __m128 rmax= c3;
+    for(int j= 0; j < 3; j++)
+    {
+        // colonne j * composante j de pMin et de pMax
+        const __m128 e= _mm_mul_ps(columns[j], _mm_set1_ps(b.pMin[j]));
+        const __m128 f= _mm_mul_ps(columns[j], _mm_set1_ps(b.pMax[j]));
+        rmin= _mm_add_ps(rmin, _mm_min_ps(e, f));
+        rmax= _mm_add_ps(rmax, _mm_max_ps(e, f));
+    }
+    
+    _mm_store_ps(&ret.pMin.x, rmin);
+    _mm_store_ps(&ret.pMax.x, rmax);
+    ret.pad0= 0.f;
+    ret.pad1= 0.f;
+#else
+    for(int i= 0; i < 3; i++)
+    {
+        float rmin= m.m[i][3];
+        float rmax= m.m[i][3];
+        for(int j= 0; j < 3; j++)
+        {
+            const float e= m.m[i][j] * b.pMin[j];
+            const float f= m.m[i][j] * b.pMax[j];
+            rmin+= std::min(e, f);
+            rmax+= std::max(e, f);
+        }
+        
+        ret.pMin[i]= rmin;
+        ret.pMax[i]= rmax;
+    }
+#endif
     
     return ret;
 }
-#endif
 
 Transform Transform::operator*( const Transform &t2 ) const
 {
-    Matrix4x4 m1 = Matrix4x4::Mul( m, t2.m );
-    Matrix4x4 m2 = Matrix4x4::Mul( t2.mInv, mInv );
-    
-    return Transform( m1, m2 );
+    // la plupart des compositions (mvp, etc.) n'utilisent que la matrice directe, 
+    // l'inverse sera calculee par inverseMatrix( ), si necessaire.
+    return Transform( Matrix4x4::Mul( m, t2.m ) );
 }
 
 bool Transform::SwapsHandedness() const
@@ -349,8 +906,20 @@ bool Transform::SwapsHandedness() const
 //! renvoie la transformation associee a une camera orthographique (Projection)
 Transform Orthographic( float znear, float zfar )
 {
-    // pbrt version
-    return Scale( 1.f, 1.f, 1.f / ( zfar - znear ) ) * Translate( Vector( 0.f, 0.f, -znear ) );
+    // pbrt version, Scale( 1.f, 1.f, 1.f / ( zfar - znear ) ) * Translate( Vector( 0.f, 0.f, -znear ) )
+    Matrix4x4 ortho(
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f / ( zfar - znear ), -znear / ( zfar - znear ),
+        0.f, 0.f, 0.f, 1.f );
+    
+    Matrix4x4 inv(
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, zfar - znear, znear,
+        0.f, 0.f, 0.f, 1.f );
+    
+    return Transform( ortho, inv );
 }
 
 //! renvoie la transformation associee a une camera orthographique (Projection)
@@ -366,7 +935,15 @@ Transform Orthographic( const float left, const float right,
         0.f, 0.f, 0.f, 1.f
     );
     
-    return Transform(ortho);
+    // inverse : echelle inverse, et translation vers le centre du volume
+    Matrix4x4 inv(
+        (right - left) / 2.f, 0.f                 , 0.f                  , (right + left) / 2.f,
+        0.f                 , (top - bottom) / 2.f, 0.f                  , (top + bottom) / 2.f,
+        0.f                 , 0.f                 , -(zfar - znear) / 2.f, -(zfar + znear) / 2.f,
+        0.f, 0.f, 0.f, 1.f
+    );
+    
+    return Transform( ortho, inv );
 }
 
 
@@ -397,8 +974,18 @@ Transform Perspective( float fov, float aspect, float znear, float zfar )
                      0,       0, (zfar+znear)*inv_denom, 2.f*zfar*znear*inv_denom,
                      0,       0,                   -1,                      0
     );
+    
+    // inverse : z' = c z + d w et w' = -z donnent z = -w' et w = (z' + c w') / d
+    const float c = (zfar+znear)*inv_denom;
+    const float d = 2.f*zfar*znear*inv_denom;
+    Matrix4x4 inv( 
+        aspect/inv_tan,           0,       0,     0,
+                     0, 1.f/inv_tan,       0,     0,
+                     0,           0,       0,    -1,
+                     0,           0, 1.f / d, c / d
+    );
 
-    return Transform(persp);
+    return Transform( persp, inv );
 #endif
 }
 
@@ -415,7 +1002,188 @@ Transform Viewport( float width, float height )
         0, 0,   0,   1
     );
     
-    return Transform(viewport);
+    Matrix4x4 inv(
+        1.f / w,       0, 0, -1,
+              0, 1.f / h, 0, -1,
+              0,       0, 2, -1,
+              0,       0, 0,  1
+    );
+    
+    return Transform( viewport, inv );
+}
+
+
+// Frustum
+Frustum::Frustum( )
+{
+    *this= Frustum( Matrix4x4() );
+}
+
+Frustum::Frustum( const Transform& mvp )
+{
+    *this= Frustum( mvp.matrix() );
+}
+
+Frustum::Frustum( const Matrix4x4& mvp )
+{
+    // -w <= x <= w, etc. : ligne 3 + ligne i >= 0, ligne 3 - ligne i >= 0
+    for(int i= 0; i < 3; i++)
+        for(int k= 0; k < 4; k++)
+        {
+            planes[2*i][k]= mvp.m[3][k] + mvp.m[i][k];
+            planes[2*i +1][k]= mvp.m[3][k] - mvp.m[i][k];
+        }
+    
+    for(int i= 0; i < 6; i++)
+    {
+        float length= sqrtf(planes[i][0]*planes[i][0] + planes[i][1]*planes[i][1] + planes[i][2]*planes[i][2]);
+        if(length > 0.f)
+            for(int k= 0; k < 4; k++)
+                planes[i][k]/= length;
+    }
+}
+
+bool Frustum::visible( const Point& center, const float radius ) const
+{
+    for(int i= 0; i < 6; i++)
+        if(planes[i][0] * center.x + planes[i][1] * center.y + planes[i][2] * center.z + planes[i][3] < -radius)
+            return false;
+    return true;
+}
+
+bool Frustum::visible( const BBox& box ) const
+{
+    // sommet de la boite le plus loin, du cote positif de chaque plan
+    for(int i= 0; i < 6; i++)
+    {
+        const float x= (planes[i][0] > 0.f) ? box.pMax.x : box.pMin.x;
+        const float y= (planes[i][1] > 0.f) ? box.pMax.y : box.pMin.y;
+        const float z= (planes[i][2] > 0.f) ? box.pMax.z : box.pMin.z;
+        if(planes[i][0] * x + planes[i][1] * y + planes[i][2] * z + planes[i][3] < 0.f)
+            return false;
+    }
+    return true;
+}
+
+//! ecrit 4 bits de visibilite a partir de l'indice i, multiple de 4.
+static
+int store_visible( unsigned int *visible, const int i, const unsigned int bits )
+{
+    if((i % 32) == 0)
+        visible[i / 32]= 0;
+    visible[i / 32]|= bits << (i % 32);
+    return ((bits & 1) != 0) + ((bits & 2) != 0) + ((bits & 4) != 0) + ((bits & 8) != 0);
+}
+
+int Frustum::visibleSpheres( const float *spheres, const int n, unsigned int *visible, const int stride ) const
+{
+    const unsigned char *data= (const unsigned char *) spheres;
+    int count= 0;
+    int i= 0;
+    
+#ifdef GK_SSE
+    // 4 spheres a la fois, une composante par registre
+    for(; i +3 < n; i+= 4)
+    {
+        __m128 x= _mm_loadu_ps((const float *) (data + (size_t) i * stride));
+        __m128 y= _mm_loadu_ps((const float *) (data + (size_t) (i +1) * stride));
+        __m128 z= _mm_loadu_ps((const float *) (data + (size_t) (i +2) * stride));
+        __m128 r= _mm_loadu_ps((const float *) (data + (size_t) (i +3) * stride));
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+        
+        const __m128 radius= _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 inside= _mm_cmpeq_ps(r, r);     // tous les bits a 1, sauf nan
+        for(int p= 0; p < 6; p++)
+        {
+            __m128 d= _mm_mul_ps(_mm_set1_ps(planes[p][0]), x);
+            d= _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes[p][1]), y));
+            d= _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes[p][2]), z));
+            d= _mm_add_ps(d, _mm_set1_ps(planes[p][3]));
+            inside= _mm_and_ps(inside, _mm_cmpge_ps(d, radius));
+        }
+        
+        count+= store_visible(visible, i, (unsigned int) _mm_movemask_ps(inside));
+    }
+#endif
+    
+    for(; i < n; i+= 4)
+    {
+        unsigned int bits= 0;
+        for(int k= 0; k < 4 && i + k < n; k++)
+        {
+            const float *sphere= (const float *) (data + (size_t) (i + k) * stride);
+            if(Frustum::visible(Point(sphere[0], sphere[1], sphere[2]), sphere[3]))
+                bits|= 1u << k;
+        }
+        count+= store_visible(visible, i, bits);
+    }
+    
+    return count;
+}
+
+int Frustum::visibleBoxes( const BBox *boxes, const int n, unsigned int *visible ) const
+{
+    int count= 0;
+    int i= 0;
+    
+#ifdef GK_SSE
+    // 4 boites a la fois : centre et demi diagonale, une composante par registre
+    const __m128 half= _mm_set1_ps(.5f);
+    const __m128 sign= _mm_set1_ps(-0.f);
+    for(; i +3 < n; i+= 4)
+    {
+        __m128 x0= _mm_load_ps(&boxes[i].pMin.x);
+        __m128 y0= _mm_load_ps(&boxes[i +1].pMin.x);
+        __m128 z0= _mm_load_ps(&boxes[i +2].pMin.x);
+        __m128 w0= _mm_load_ps(&boxes[i +3].pMin.x);
+        _MM_TRANSPOSE4_PS(x0, y0, z0, w0);
+        __m128 x1= _mm_load_ps(&boxes[i].pMax.x);
+        __m128 y1= _mm_load_ps(&boxes[i +1].pMax.x);
+        __m128 z1= _mm_load_ps(&boxes[i +2].pMax.x);
+        __m128 w1= _mm_load_ps(&boxes[i +3].pMax.x);
+        _MM_TRANSPOSE4_PS(x1, y1, z1, w1);
+        
+        const __m128 cx= _mm_mul_ps(_mm_add_ps(x0, x1), half);
+        const __m128 cy= _mm_mul_ps(_mm_add_ps(y0, y1), half);
+        const __m128 cz= _mm_mul_ps(_mm_add_ps(z0, z1), half);
+        const __m128 ex= _mm_mul_ps(_mm_sub_ps(x1, x0), half);
+        const __m128 ey= _mm_mul_ps(_mm_sub_ps(y1, y0), half);
+        const __m128 ez= _mm_mul_ps(_mm_sub_ps(z1, z0), half);
+        
+        // une boite vide a une demi diagonale negative, et n'est jamais visible
+        __m128 inside= _mm_and_ps(_mm_cmpge_ps(ex, _mm_setzero_ps()), 
+            _mm_and_ps(_mm_cmpge_ps(ey, _mm_setzero_ps()), _mm_cmpge_ps(ez, _mm_setzero_ps())));
+        for(int p= 0; p < 6; p++)
+        {
+            const __m128 a= _mm_set1_ps(planes[p][0]);
+            const __m128 b= _mm_set1_ps(planes[p][1]);
+            const __m128 c= _mm_set1_ps(planes[p][2]);
+            
+            // distance du centre + projection de la demi diagonale sur la normale
+            __m128 d= _mm_mul_ps(a, cx);
+            d= _mm_add_ps(d, _mm_mul_ps(b, cy));
+            d= _mm_add_ps(d, _mm_mul_ps(c, cz));
+            d= _mm_add_ps(d, _mm_set1_ps(planes[p][3]));
+            d= _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, a), ex));
+            d= _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, b), ey));
+            d= _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, c), ez));
+            inside= _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+        }
+        
+        count+= store_visible(visible, i, (unsigned int) _mm_movemask_ps(inside));
+    }
+#endif
+    
+    for(; i < n; i+= 4)
+    {
+        unsigned int bits= 0;
+        for(int k= 0; k < 4 && i + k < n; k++)
+            if(boxes[i + k].IsEmpty() == false && Frustum::visible(boxes[i + k]))
+                bits|= 1u << k;
+        count+= store_visible(visible, i, bits);
+    }
+    
+    return count;
 }
 
 } // namespace
@@ -26,25 +26,29 @@ struct Matrix4x4
 {
     // Matrix4x4 Public Methods
     //! construit une matrice identite, par defaut.
-    Matrix4x4( )
-    {
-        for(int i = 0; i < 4; ++i)
-            for(int j = 0; j < 4; ++j)
-                m[i][j] = 0.f;
-        
-        for(int k= 0; k < 4; k++)
-            m[k][k]= 1.f;
-    }
+    constexpr Matrix4x4( )
+        :
+        m{ { 1.f, 0.f, 0.f, 0.f }, 
+           { 0.f, 1.f, 0.f, 0.f }, 
+           { 0.f, 0.f, 1.f, 0.f }, 
+           { 0.f, 0.f, 0.f, 1.f } }
+    {}
     
     //! construit une matrice a partir d'un tableau 2d de reels [ligne][colonne].
     Matrix4x4( const float mat[4][4] );
     
-    //! construit une matrice a partir des 16 elements.
-    Matrix4x4( 
+    //! construit une matrice a partir des 16 elements, utilisable dans une expression constante.
+    constexpr Matrix4x4( 
        float t00, float t01, float t02, float t03,
        float t10, float t11, float t12, float t13,
        float t20, float t21, float t22, float t23,
-       float t30, float t31, float t32, float t33 );
+       float t30, float t31, float t32, float t33 )
+        :
+        m{ { t00, t01, t02, t03 }, 
+           { t10, t11, t12, t13 }, 
+           { t20, t21, t22, t23 }, 
+           { t30, t31, t32, t33 } }
+    {}
     
     //! renvoie la matrice transposee.
     Matrix4x4 Transpose( ) const;
@@ -83,21 +87,9 @@ struct Matrix4x4
     }
     
     //! produit de 2 matrices : renvoie m1 * m2.
+    //! utilise sse ou avx, selon le processeur, les resultats sont identiques a ceux du produit scalaire.
     static 
-    Matrix4x4 Mul( const Matrix4x4 &m1, const Matrix4x4 &m2 )
-    {
-        float r[4][4];
-        
-        for (int i = 0; i < 4; ++i)
-            for (int j = 0; j < 4; ++j)
-                r[i][j] = 
-                    m1.m[i][0] * m2.m[0][j] +
-                    m1.m[i][1] * m2.m[1][j] +
-                    m1.m[i][2] * m2.m[2][j] +
-                    m1.m[i][3] * m2.m[3][j];
-        
-        return Matrix4x4(r);
-    }
+    Matrix4x4 Mul( const Matrix4x4 &m1, const Matrix4x4 &m2 );
     
     static
     Vector Transform( const Matrix4x4& m, const Vector& v )
@@ -130,6 +122,11 @@ struct Matrix4x4
         else
             return Point( xt, yt, zt ) / wt;        
     }
+    
+    //! transforme n points, utilise sse ou avx, selon le processeur. 
+    //! meme resultat que Transform(m, points[i]), result et points peuvent etre le meme tableau.
+    static
+    void Transform( const Matrix4x4& m, const Point *points, Point *result, const int n );
 
     static
     Normal Transform( const Matrix4x4& m, const Normal& n )
@@ -162,8 +159,8 @@ struct Matrix4x4
         return (const float *) m;
     }
     
-    //! elements de la matrice.
-    float m[4][4];
+    //! elements de la matrice, alignes sur 16 octets pour sse.
+    alignas(16) float m[4][4];
 };
 
 
@@ -174,28 +171,17 @@ class Transform
 public:
     // Transform Public Methods
     //! constructeur par defaut, transformation identite.
-    Transform( ) {}
+    constexpr Transform( ) : m(), mInv(), mInvValid(true) {}
     
     //! construction a partir d'une matrice representee par un tableau 2d de reels.
-    Transform( float mat[4][4] )
-    {
-        m= Matrix4x4(mat);
-        mInv = m.getInverse();
-    }
+    //! l'inverse n'est calculee qu'a sa premiere utilisation.
+    Transform( float mat[4][4] ) : m(mat), mInv(), mInvValid(false) {}
     
-    //! construction a partir d'une matrice.
-    Transform( const Matrix4x4& mat )
-    {
-        m = mat;
-        mInv = m.getInverse();
-    }
+    //! construction a partir d'une matrice, l'inverse n'est calculee qu'a sa premiere utilisation.
+    constexpr Transform( const Matrix4x4& mat ) : m(mat), mInv(), mInvValid(false) {}
     
     //! construction a partir d'une matrice et de son inverse.
-    Transform( const Matrix4x4& mat, const Matrix4x4& minv )
-    {
-        m = mat;
-        mInv = minv;
-    }
+    constexpr Transform( const Matrix4x4& mat, const Matrix4x4& minv ) : m(mat), mInv(minv), mInvValid(true) {}
     
     //! affiche la matrice representant la transformation.
     void print() const
@@ -210,7 +196,7 @@ public:
     }
     
     //! renvoie la transformation sous forme de matrice.
-    const Matrix4x4& matrix( ) const
+    constexpr const Matrix4x4& matrix( ) const
     {
         return m;
     }
@@ -220,22 +206,29 @@ public:
         return m.Transpose();
     }
     
-    //! renvoie la transformation inverse sous forme de matrice.
+    //! renvoie la transformation inverse sous forme de matrice, calculee a la premiere utilisation.
+    //! attention : n'est pas thread safe, la premiere utilisation modifie la transformation.
     const Matrix4x4& inverseMatrix( ) const
     {
+        if(!mInvValid)
+        {
+            mInv = m.getInverse();
+            mInvValid = true;
+        }
+        
         return mInv;
     }
     
     //! renvoie la matrice de transformation des normales associee a la transformation directe = inverse transpose.
     Matrix4x4 normalMatrix( ) const
     {
-        return mInv.Transpose();
+        return inverseMatrix().Transpose();
     }
     
     //! renvoie la transformation inverse.
     Transform getInverse() const
     {
-        return Transform( mInv, m );
+        return Transform( inverseMatrix(), m );
     }
     
     //! \name transformations de points, vecteurs, normales, rayons, aabox. passage du repere '1' au repere '2'.
@@ -247,6 +240,23 @@ public:
     inline void operator()( const Vector &v, Vector &vt ) const;
     inline Normal operator()( const Normal & ) const;
     inline void operator()( const Normal &, Normal &nt ) const;
+    
+    //! transforme une boite englobante, renvoie la boite englobante du resultat.
+    BBox operator()( const BBox &b ) const;
+    // @}
+
+    //! \name transformations de tableaux de n points, vecteurs, normales : x y z consecutifs (AoS), ou 3 tableaux x, y, z (SoA).
+    //! memes resultats que les transformations individuelles, utilisent sse ou avx, selon le processeur.
+    //! result peut etre le tableau d'entree. parallel repartit les gros tableaux sur plusieurs threads.
+    // @{
+    void transformPoints( const float *points, float *result, const int n, const bool parallel= false ) const;
+    void transformVectors( const float *vectors, float *result, const int n, const bool parallel= false ) const;
+    void transformNormals( const float *normals, float *result, const int n, const bool parallel= false ) const;
+    void transformPoints( const float *x, const float *y, const float *z, float *rx, float *ry, float *rz, 
+        const int n, const bool parallel= false ) const;
+    
+    //! transformation projective des points, sans division : result contient n x y z w, par exemple dans le repere clip.
+    void transformClip( const float *points, float *result, const int n, const bool parallel= false ) const;
     // @}
 
     //! \name transformations inverses de points, vecteurs, normales, rayons, aabox. passage du repere '2' vers le repere '1'.
@@ -260,15 +270,54 @@ public:
     inline void inverse( const Normal &, Normal &nt ) const;
     // @}
     
-    //! composition de 2 transformations.
+    //! composition de 2 transformations, un seul produit de matrices, l'inverse est calculee a sa premiere utilisation.
+    //! cf. Compose( ) pour composer plusieurs transformations en une seule evaluation.
     Transform operator*( const Transform &t2 ) const;
     
+    //! renvoie vrai si l'inverse est connue, sans la calculer.
+    bool hasInverse( ) const
+    {
+        return mInvValid;
+    }
+    
     bool SwapsHandedness() const;
 
 protected:
     // Transform Private Data
     //! les matrices directe et inverse de changement de repere.
-    Matrix4x4 m, mInv;
+    Matrix4x4 m;
+    mutable Matrix4x4 mInv;
+    mutable bool mInvValid;     //!< faux tant que mInv n'est pas calculee, cf. inverseMatrix( ).
+};
+
+//! pyramide de vision : 6 plans normalises, extraits d'une matrice de projection, 
+//! cf. "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix", Gribb, Hartmann, 2001.
+//! les plans sont exprimes dans le repere de depart de la matrice (repere objet pour une mvp), 
+//! et orientes vers l'interieur : a x + b y + c z + d >= 0 pour un point dans la pyramide.
+//! les tests sont conservatifs : un objet proche d'un coin peut etre declare visible.
+class Frustum
+{
+public:
+    //! pyramide de la transformation identite, le cube [-1 1].
+    Frustum( );
+    //! extrait les plans de la matrice mvp.
+    Frustum( const Matrix4x4& mvp );
+    Frustum( const Transform& mvp );
+    
+    //! renvoie vrai si la sphere touche la pyramide.
+    bool visible( const Point& center, const float radius ) const;
+    //! renvoie vrai si la boite touche la pyramide.
+    bool visible( const BBox& box ) const;
+    
+    //! teste n spheres, x y z rayon, separees par stride octets. utilise sse, selon le processeur.
+    //! le bit i de visible, visible[i / 32] & (1u << (i % 32)), vaut 1 si la sphere i touche la pyramide, (n + 31) / 32 mots.
+    //! renvoie le nombre de spheres visibles.
+    int visibleSpheres( const float *spheres, const int n, unsigned int *visible, const int stride= sizeof(float [4]) ) const;
+    //! teste n boites, meme representation du resultat que visibleSpheres( ).
+    int visibleBoxes( const BBox *boxes, const int n, unsigned int *visible ) const;
+    
+    //! a b c d de chaque plan : gauche, droite, bas, haut, proche, loin.
+    float planes[6][4];
 };
 
 Transform Viewport( float width, float height );
@@ -280,9 +329,97 @@ Transform Rotate( float angle, const Vector &axis );
 Transform RotateX( float angle );
 Transform RotateY( float angle );
 Transform RotateZ( float angle );
-Transform Scale( float x, float y, float z );
-Transform Scale( float value );
-Transform Translate( const Vector &delta );
+
+//! renvoie la transformation associee au changement d'echelle (x, y, z), utilisable dans une expression constante.
+constexpr inline
+Transform Scale( float x, float y, float z )
+{
+    return Transform( 
+        Matrix4x4(
+            x, 0, 0, 0,
+            0, y, 0, 0,
+            0, 0, z, 0,
+            0, 0, 0, 1 ),
+        Matrix4x4(
+            1.f / x,       0,       0, 0,
+                  0, 1.f / y,       0, 0,
+                  0,       0, 1.f / z, 0,
+                  0,       0,       0, 1 ) );
+}
+
+//! renvoie la transformation associee au changement d'echelle (v, v, v), utilisable dans une expression constante.
+constexpr inline
+Transform Scale( float v )
+{
+    return Scale( v, v, v );
+}
+
+//! renvoie la transformation associee a une translatation du vecteur delta, utilisable dans une expression constante.
+constexpr inline
+Transform Translate( const Vector &delta )
+{
+    return Transform( 
+        Matrix4x4(
+            1, 0, 0, delta.x,
+            0, 1, 0, delta.y,
+            0, 0, 1, delta.z,
+            0, 0, 0,       1 ),
+        Matrix4x4( 
+            1, 0, 0, -delta.x,
+            0, 1, 0, -delta.y,
+            0, 0, 1, -delta.z,
+            0, 0, 0,        1 ) );
+}
+
+
+//! composition differee de N transformations, cf. Compose( ).
+//! les transformations sont referencees, elles doivent exister tant que la composition est utilisee.
+template < int N >
+struct TransformChain
+{
+    const Transform *transforms[N];
+    
+    //! produit des matrices, de gauche a droite, sans temporaires Transform.
+    Matrix4x4 matrix( ) const
+    {
+        Matrix4x4 r= transforms[0]->matrix();
+        for(int i= 1; i < N; i++)
+            r= Matrix4x4::Mul(r, transforms[i]->matrix());
+        return r;
+    }
+    
+    //! produit des inverses, dans l'ordre inverse, cf. transformWithInverse( ).
+    Matrix4x4 inverseMatrix( ) const
+    {
+        Matrix4x4 r= transforms[N-1]->inverseMatrix();
+        for(int i= N-2; i >= 0; i--)
+            r= Matrix4x4::Mul(r, transforms[i]->inverseMatrix());
+        return r;
+    }
+    
+    //! construit la transformation, son inverse n'est calculee qu'a sa premiere utilisation, cf. Transform::inverseMatrix( ).
+    operator Transform( ) const
+    {
+        return Transform( matrix() );
+    }
+    
+    //! construit la transformation et son inverse, le produit des inverses des transformations, 
+    //! sans inversion generale de la matrice. a utiliser lorsque l'inverse de la composition est necessaire.
+    Transform transformWithInverse( ) const
+    {
+        return Transform( matrix(), inverseMatrix() );
+    }
+};
+
+//! composition de plusieurs transformations, evaluee en une seule fois : 
+//! Compose(projection, view, model).matrix() == (projection * view * model).matrix()
+//! Compose(projection, view, model).transformWithInverse( ) calcule aussi l'inverse, a partir des inverses connues de projection, view et model.
+template < typename ... T >
+TransformChain<sizeof...(T)> Compose( const T& ... t )
+{
+    TransformChain<sizeof...(T)> chain= { { &t ... } };
+    return chain;
+}
 
 
 // Transform Inline Functions
@@ -351,6 +488,7 @@ void Transform::operator()( const Vector &v, Vector &vt ) const
 inline 
 Normal Transform::operator()( const Normal &n ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = n.x;
     const float y = n.y;
     const float z = n.z;
@@ -364,6 +502,7 @@ Normal Transform::operator()( const Normal &n ) const
 inline 
 void Transform::operator()( const Normal &n, Normal& nt ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = n.x;
     const float y = n.y;
     const float z = n.z;
@@ -377,6 +516,7 @@ void Transform::operator()( const Normal &n, Normal& nt ) const
 inline 
 Point Transform::inverse( const Point &p ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = p.x;
     const float y = p.y;
     const float z = p.z;
@@ -397,6 +537,7 @@ Point Transform::inverse( const Point &p ) const
 inline 
 void Transform::inverse( const Point &p, Point &pt ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = p.x;
     const float y = p.y;
     const float z = p.z;
@@ -414,6 +555,7 @@ void Transform::inverse( const Point &p, Point &pt ) const
 inline 
 Vector Transform::inverse( const Vector &v ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = v.x;
     const float y = v.y;
     const float z = v.z;
@@ -427,6 +569,7 @@ Vector Transform::inverse( const Vector &v ) const
 inline 
 void Transform::inverse( const Vector &v, Vector &vt ) const
 {
+    const Matrix4x4& mInv = inverseMatrix();
     const float x = v.x;
     const float y = v.y;
     const float z = v.z;
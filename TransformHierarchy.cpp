@@ -0,0 +1,123 @@
+
+#include "TransformHierarchy.h"
+#include "Parallel.h"
+
+
+namespace gk {
+
+int TransformHierarchy::insert( const int parent, const Matrix4x4& local )
+{
+    if(parent < -1 || parent >= size())
+        return -1;
+    
+    const int node= size();
+    const int level= (parent < 0) ? 0 : levels[parent] +1;
+    locals.push_back(local);
+    worlds.push_back(local);
+    parents.push_back(parent);
+    levels.push_back(level);
+    first_child.push_back(-1);
+    next_sibling.push_back(-1);
+    dirty.push_back(1);
+    if(parent >= 0)
+    {
+        next_sibling[node]= first_child[parent];
+        first_child[parent]= node;
+    }
+    
+    if(level >= (int) level_dirty.size())
+        level_dirty.resize(level +1);
+    level_dirty[level].push_back(node);
+    return node;
+}
+
+void TransformHierarchy::setLocal( const int node, const Matrix4x4& local )
+{
+    locals[node]= local;
+    if(dirty[node] == 0)
+        level_dirty[levels[node]].push_back(node);
+    dirty[node]= 1;
+}
+
+void TransformHierarchy::reserve( const int n )
+{
+    locals.reserve(n);
+    worlds.reserve(n);
+    parents.reserve(n);
+    levels.reserve(n);
+    first_child.reserve(n);
+    next_sibling.reserve(n);
+    dirty.reserve(n);
+}
+
+void TransformHierarchy::clear( )
+{
+    *this= TransformHierarchy();
+}
+
+
+//! updates the nodes [begin, end) of the update list of a level, their parents are up to date.
+struct update_level_task
+{
+    const int *nodes;
+    const Matrix4x4 *locals;
+    Matrix4x4 *worlds;
+    const int *parents;
+    
+    void operator()( const unsigned int begin, const unsigned int end ) const
+    {
+        for(unsigned int i= begin; i < end; i++)
+        {
+            const int node= nodes[i];
+            const int parent= parents[node];
+            if(parent < 0)
+                worlds[node]= locals[node];
+            else
+                worlds[node]= Matrix4x4::Mul(worlds[parent], locals[node]);
+        }
+    }
+};
+
+int TransformHierarchy::update( const bool parallel )
+{
+    int count= 0;
+    for(unsigned int l= 0; l < level_dirty.size(); l++)
+    {
+        std::vector<int>& nodes= level_dirty[l];
+        if(nodes.empty())
+            continue;
+        
+        update_level_task task;
+        task.nodes= &nodes.front();
+        task.locals= &locals.front();
+        task.worlds= &worlds.front();
+        task.parents= &parents.front();
+        
+        // a few thousand products per range, smaller levels run on the calling thread
+        if(parallel)
+            parallel_for((unsigned int) nodes.size(), task, 4096);
+        else
+            task(0, (unsigned int) nodes.size());
+        
+        // the children of the updated nodes are updated with the next level
+        for(unsigned int i= 0; i < nodes.size(); i++)
+        {
+            const int node= nodes[i];
+            for(int child= first_child[node]; child >= 0; child= next_sibling[child])
+            {
+                if(dirty[child] == 0)
+                    level_dirty[l +1].push_back(child);
+                dirty[child]= 1;
+            }
+            
+            dirty[node]= 0;
+        }
+        
+        count+= (int) nodes.size();
+        nodes.clear();
+    }
+    
+    return count;
+}
+
+}       // namespace
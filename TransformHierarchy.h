@@ -0,0 +1,54 @@
+
+#ifndef _GK_TRANSFORM_HIERARCHY_H
+#define _GK_TRANSFORM_HIERARCHY_H
+
+#include <vector>
+
+#include "Transform.h"
+
+
+namespace gk {
+
+//! flat transform hierarchy, one array per field: local matrices, parent indices, cached world matrices and dirty flags.
+//! a parent is inserted before its children. update( ) recomputes the dirty nodes and their descendants only, 
+//! level by level: each level keeps the list of its nodes to update, the nodes of a level are updated in parallel.
+class TransformHierarchy
+{
+public:
+    TransformHierarchy( ) : locals(), worlds(), parents(), levels(), first_child(), next_sibling(), dirty(), level_dirty() {}
+    
+    //! adds a node, parent is -1 for a root. returns the index of the node, or -1 if parent does not exist.
+    int insert( const int parent, const Matrix4x4& local= Matrix4x4() );
+    
+    //! changes the local transform of a node, its world matrix, and those of its descendants, are updated by update( ).
+    void setLocal( const int node, const Matrix4x4& local );
+    
+    const Matrix4x4& local( const int node ) const { return locals[node]; }
+    //! world matrix of a node, up to date after update( ).
+    const Matrix4x4& world( const int node ) const { return worlds[node]; }
+    int parent( const int node ) const { return parents[node]; }
+    int level( const int node ) const { return levels[node]; }
+    int size( ) const { return (int) parents.size(); }
+    
+    //! recomputes the world matrices of the dirty nodes and of their descendants. returns the number of updated nodes.
+    //! parallel splits the large levels over the worker threads, cf. parallel_for( ).
+    int update( const bool parallel= true );
+    
+    void reserve( const int n );
+    void clear( );
+    
+protected:
+    std::vector<Matrix4x4> locals;
+    std::vector<Matrix4x4> worlds;
+    std::vector<int> parents;
+    std::vector<int> levels;    //!< depth of each node, 0 for roots
+    std::vector<int> first_child;       //!< -1 for a leaf
+    std::vector<int> next_sibling;      //!< -1 for the last child
+    std::vector<unsigned char> dirty;   //!< node in the update list of its level
+    
+    std::vector< std::vector<int> > level_dirty;        //!< nodes of each level to update: dirty nodes, and children of updated nodes
+};
+
+}       // namespace
+
+#endif
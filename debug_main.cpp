@@ -19,8 +19,10 @@ int windowWidth= 0;
 int windowHeight= 0;
 
 Mesh mesh;
+MeshRequest *mesh_request= NULL;
+BufferArena *arena= NULL;
 GLuint program;
-GLuint attributes;
+GLuint attributes= 0;
 
 int setUniform( const char *name, const gk::Matrix4x4& matrix )
 {
@@ -47,9 +49,38 @@ int setUniform( const char *name, const float x, const float y, const float z, c
 }
 
 
+int init_attributes( );
+
 void draw( )
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    // upload the mesh, a few MB per frame, once loaded by the worker thread
+    if(mesh_request != NULL)
+    {
+        int status= upload_OBJ(mesh_request, mesh);
+        if(status != 0)
+        {
+            release_OBJ(mesh_request);
+            mesh_request= NULL;
+        }
+        if(status < 0)
+        {
+            ERROR("failed.\n");
+            glutLeaveMainLoop();
+            return;
+        }
+        if(status > 0)
+            init_attributes();
+    }
+    
+    if(attributes == 0)
+    {
+        // not ready yet
+        glutSwapBuffers();
+        glutPostRedisplay();
+        return;
+    }
 
     // draw something
     glBindVertexArray(attributes);
@@ -67,14 +98,19 @@ void draw( )
     gk::Transform view= gk::Translate( gk::Vector(0.f, 0.f, -30.f) );
     gk::Transform projection= gk::Perspective(50.f, 1.f, 1.f, 1000.f);
     gk::Transform mvp= projection * view * model;
-    setUniform("mvpMatrix", mvp.matrix());
+    
+    // quantized positions
+    gk::Transform dequantize= gk::Translate( gk::Vector(mesh.position_offset[0], mesh.position_offset[1], mesh.position_offset[2]) ) 
+        * gk::Scale(mesh.position_scale);
+    setUniform("mvpMatrix", (mvp * dequantize).matrix());
     
     if(mesh.indices > 0)
     {
         // usual openGL draw call:
-        // glDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, 0);
+        // glDrawElements(GL_TRIANGLES, mesh.count, mesh.index_type, (const GLvoid *) mesh.indices_offset);
         // replaced by:
-        gk::DebugDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, 0, "position");
+        gk::DebugDrawClusters(mesh.clusters, mesh.cluster_count, mvp.matrix(), mesh.indices_offset);
+        gk::DebugDrawElements(GL_TRIANGLES, mesh.count, mesh.index_type, (const GLvoid *) mesh.indices_offset, "position");
     }
     else
     {
@@ -92,26 +128,18 @@ void draw( )
 }
 
 
-int init( )
+// core profile : use a vertex array, once the mesh is ready
+int init_attributes( )
 {
-    using namespace gk::debug;  // use available shader helpers from DebugDraw.
-    
-    mesh= read_OBJ("bigguy.vbo.obj");   // read a mesh
     if(mesh.count == 0)
         return -1;
     
-    // compile some shaders
-    //~ program= create_program_from_file("vertex.vsl", "fragment_array.fsl");
-    program= create_program_from_file("vertex.vsl", "fragment.fsl");
-    if(program == 0)
-        return -1;
-
-    // core profile : use a vertex array
     attributes= create_vertex_array();
     glBindBuffer(GL_ARRAY_BUFFER, mesh.positions);
     {
         int location= glGetAttribLocation(program, "position");
-        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribPointer(location, mesh.position_size, mesh.position_type, mesh.position_type != GL_FLOAT, 0, 
+            (const GLvoid *) mesh.positions_offset);
         glEnableVertexAttribArray(location);
     }
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indices);
@@ -120,6 +148,23 @@ int init( )
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return 0;
+}
+
+int init( )
+{
+    using namespace gk::debug;  // use available shader helpers from DebugDraw.
+    
+    // read a mesh on a worker thread, reorder triangles and vertices for the gpu, or load its cache
+    // vertices and indices are suballocated in the buffers of the arena
+    arena= create_arena();
+    mesh_request= read_OBJ_async("bigguy.vbo.obj", MESH_OPTIMIZE | MESH_CLUSTERS | MESH_QUANTIZE | MESH_CACHE, arena);
+    
+    // compile some shaders
+    //~ program= create_program_from_file("vertex.vsl", "fragment_array.fsl");
+    program= create_program_from_file("vertex.vsl", "fragment.fsl");
+    if(program == 0)
+        return -1;
     
     // set up state
     glEnable(GL_CULL_FACE);
@@ -129,6 +174,11 @@ int init( )
 // clean up
 void quit( )
 {
+    release_OBJ(mesh_request);
+    mesh_request= NULL;
+    release_mesh(mesh, arena);
+    release_arena(arena);
+    arena= NULL;
     return;
 }
 
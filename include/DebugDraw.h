@@ -6,10 +6,35 @@
 
 
 namespace gk {
-    
+
+//! cluster of triangles, contiguous range of an index buffer, with a bounding sphere and a normal cone.
+//! stored in a buffer object, cf. DebugDrawClusters( ).
+struct DebugCluster
+{
+    float center[3];    //!< bounding sphere
+    float radius;
+    float cone_axis[3];         //!< normal cone, 
+    float cone_cutoff;          //!< the cluster is back facing when dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff, > 1 when undefined
+    float cone_apex[3];
+    unsigned int first;         //!< first index of the cluster in the index buffer
+    unsigned int count;         //!< index count
+    unsigned int vertex_count;  //!< unique vertices
+    unsigned int pad[2];
+};
+
 void DebugDrawArrays( const GLenum  mode, const GLint first, const GLsizei count, const char *position= NULL );
 void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum type, const GLvoid *indices, const char *position= NULL );
 
+//! sizes of the fifo and lru post transform vertex caches simulated by DebugDrawElements( ), 0 disables a simulation.
+void DebugDrawVertexCache( const int fifo_size= 16, const int lru_size= 32 );
+//! declares the clusters of the next indexed debug draws: the vertex panel displays each cluster with a different color, 
+//! and reports the clusters culled by their bounding sphere or normal cone, for the mvp matrix (row major, as gk::Matrix4x4). 
+//! buffer == 0 disables the cluster display. 
+//! index_offset is the byte offset of the mesh indices in the index buffer, cluster ranges are relative to it.
+void DebugDrawClusters( const GLuint buffer, const int count, const float *mvp= NULL, const GLint64 index_offset= 0 );
+//! signals that the content of a buffer changed, invalidates the results computed from the buffer.
+void DebugBufferChanged( const GLuint buffer );
+
 }       // namespace
 
 #endif
@@ -0,0 +1,105 @@
+
+#ifndef _GK_DEBUGDRAW_ANALYSIS_H
+#define _GK_DEBUGDRAW_ANALYSIS_H
+
+
+namespace gk {
+
+namespace debug {
+
+//! post transform vertex cache replacement policies.
+enum {
+    VERTEX_CACHE_FIFO= 0,
+    VERTEX_CACHE_LRU
+};
+
+//! post transform vertex cache statistics.
+struct vertex_cache_stats
+{
+    int policy;
+    int cache_size;
+    int triangles;
+    int vertices;       //!< number of unique vertices referenced by the triangles
+    int misses;         //!< number of transformed vertices
+    float acmr;         //!< average cache miss ratio, misses / triangles, 0.5 at best, 3 at worst
+    float atvr;         //!< average transform to vertex ratio, misses / vertices, 1 at best
+    
+    vertex_cache_stats( )
+        :
+        policy(VERTEX_CACHE_FIFO),
+        cache_size(0),
+        triangles(0),
+        vertices(0),
+        misses(0),
+        acmr(0.f),
+        atvr(0.f)
+    {}
+};
+
+//! simulates a post transform vertex cache of cache_size entries, indices describe a triangle list.
+vertex_cache_stats simulate_vertex_cache( const unsigned int *indices, const int count, const int policy, const int cache_size );
+
+//! screen space triangle area histogram, bin 0: area < 1 pixel, bin i: area in [2^(i-1), 2^i) pixels, the last bin counts larger triangles.
+struct triangle_size_stats
+{
+    enum { BINS= 12 };
+    
+    int bins[BINS];
+    int triangles;      //!< measured triangles, 
+    int clipped;        //!< triangles crossing the w= 0 plane, not measured
+    float subpixel;     //!< fraction of measured triangles smaller than 1 pixel
+    float small;        //!< fraction of measured triangles smaller than 16 pixels
+    
+    triangle_size_stats( )
+        :
+        triangles(0),
+        clipped(0),
+        subpixel(0.f),
+        small(0.f)
+    {
+        for(int i= 0; i < BINS; i++)
+            bins[i]= 0;
+    }
+};
+
+//! computes the pixel area of triangles, given clip space positions (4 floats per vertex, indexed by indices - first) and a viewport (x, y, width, height).
+triangle_size_stats triangle_size_histogram( const float *clip_positions, const unsigned int first, 
+    const unsigned int *indices, const int count, const int viewport[4] );
+
+//! face culling modes, cf. glCullFace( ).
+enum {
+    CULL_BACK_BIT= 1,
+    CULL_FRONT_BIT= 2
+};
+
+//! triangle classification, each triangle is counted once, in this order: outside, culled, degenerate, visible.
+struct culling_stats
+{
+    int triangles;
+    int outside;        //!< outside the frustum, all vertices outside the same clipping plane
+    int culled;         //!< culled by the face culling mode (or would be culled, when face culling is disabled)
+    int degenerate;     //!< zero area
+    int visible;
+    int clipped;        //!< visible triangles crossing a clipping plane
+    
+    culling_stats( )
+        :
+        triangles(0),
+        outside(0),
+        culled(0),
+        degenerate(0),
+        visible(0),
+        clipped(0)
+    {}
+};
+
+//! classifies triangles, given clip space positions (4 floats per vertex, indexed by indices - first), 
+//! the culling mode (CULL_BACK_BIT | CULL_FRONT_BIT) and the orientation of front faces.
+culling_stats classify_triangles( const float *clip_positions, const unsigned int first, 
+    const unsigned int *indices, const int count, const unsigned int cull_mode, const bool front_ccw );
+
+}       // namespace debug
+
+}       // namespace gk
+
+#endif
@@ -4,22 +4,77 @@
 
 #include <cstdio>
 #include <string>
-#include <set>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 
 namespace gk {
 
-//! affiche une seule fois chaque message.
+//! affiche une seule fois chaque warning et erreur, identifies par leur appel : fichier, ligne et format.
+//! les occurrences suivantes ne sont pas formatees, elles sont comptees et resumees periodiquement.
+//! les messages sont formates par le thread appelant, places dans une file de taille fixe, et ecrits par un thread dedie.
+//! lorsque la file est pleine, les messages de type MESSAGE sont perdus et comptes, les warnings et les erreurs attendent une place libre.
 class Log
 {
     // non copyable
     Log( const Log& );
     Log& operator= ( const Log& );
-
-    std::set<std::string> m_slots;
+    
+    //! message en attente d'ecriture.
+    struct Record
+    {
+        std::atomic<unsigned int> sequence;     //!< etat de l'element, cf. write() et writer()
+        unsigned int type;
+        const char *file;       //!< __FILE__, chaine statique
+        int line;
+        char text[1024];
+    };
+    
+    enum { RECORD_COUNT= 1024 };        //!< puissance de 2, 1Mo
+    
+    //! appel de WARNING() ou ERROR().
+    struct Site
+    {
+        std::atomic<unsigned long long int> key;        //!< hash de l'appel, 0 pour un element libre
+        std::atomic<unsigned int> count;        //!< nombre d'occurrences
+        std::atomic<int> line;
+        std::atomic<const char *> file; //!< publie line, NULL tant que l'element n'est pas complet
+        unsigned int reported;  //!< occurrences deja resumees, utilise par le thread d'ecriture
+    };
+    
+    enum { SITE_COUNT= 4096 };  //!< puissance de 2, les appels suivants ne sont pas filtres
+    enum { SITE_PROBES= 16 };
+    
+    Record m_records[RECORD_COUNT];
+    Site m_sites[SITE_COUNT];
+    std::atomic<unsigned int> m_tail;   //!< prochain element a remplir, partage par les threads qui ecrivent
+    unsigned int m_head;        //!< prochain element a ecrire, utilise par le thread d'ecriture
+    std::atomic<unsigned int> m_dropped;        //!< nombre de messages perdus, file pleine
+    unsigned int m_dropped_reported;
+    
+    std::chrono::steady_clock::time_point m_summary;    //!< date du dernier resume
     FILE *m_output;
-    unsigned int m_level;
+    std::atomic<unsigned int> m_level;  //!< lu par les threads qui ecrivent, sans verrou
+    std::mutex m_lock;  //!< protege m_output et le reveil du thread d'ecriture
+    std::condition_variable m_wakeup;
+    std::condition_variable m_flushed;  //!< reveille flush( ), un message est publie
+    bool m_stop;
+    std::thread m_writer;
+    
+    //! thread d'ecriture.
+    void writer( );
+    //! ecrit les messages en attente, m_lock est verrouille. renvoie le nombre de messages ecrits.
+    int drain( );
+    //! ecrit un message, m_lock est verrouille.
+    void output( const Record& record );
+    //! ecrit le nombre d'occurrences supprimees de chaque appel, depuis le dernier resume, m_lock est verrouille.
+    void summarize( );
+    //! renvoie vrai si l'appel doit etre affiche, la premiere occurrence, faux pour les suivantes.
+    bool first( const char *file, const int line, const char *format );
     
 public:
     
@@ -32,12 +87,18 @@ public:
 
     //! constructeur par defaut.
     Log( );
-    //! destructeur.
+    //! destructeur. ecrit les messages en attente.
     ~Log( );
     
     //! utilsation interne. filtre un message formate / printf.
     //! utiliser les macros MESSAGE(), WARNING() et ERROR() a la place.
     void write( const unsigned int type, const char *file, const int line, const char *function, const char *format, ...);
+    
+    //! attend l'ecriture des messages en attente, y compris ceux en cours de formatage par les autres threads, et resume les occurrences supprimees.
+    void flush( );
+    
+    //! renvoie le nombre de messages (MESSAGE) perdus, lorsque la file etait pleine.
+    unsigned int dropped( ) const { return m_dropped; }
 
     //! redirige les messages vers un fichier texte.
     int setOutputFile( const char *filename );
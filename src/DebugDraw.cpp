@@ -3,12 +3,17 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
+#include <string>
 #include <vector>
+#include <map>
 #include <limits>
+#include <algorithm>
 
 #include "Logger.h"
 #include "DebugDraw.h"
 #include "DebugDrawShaders.h"
+#include "DebugDrawAnalysis.h"
 
 #include "Transform.h"
 
@@ -18,8 +23,13 @@ namespace gk {
 namespace debug {
 
 GLint active_cull_test= 0;
+GLint active_cull_face_mode= GL_BACK;
+GLint active_front_face= GL_CCW;
 GLint active_polygon_modes[2];  //! \bug nvidia driver fills 2 GLenums instead of 1, according to state tables GL 4.3 core profile
 GLint active_viewport[4];
+GLint active_depth_test= 0;
+GLint active_depth_func= GL_LESS;
+GLboolean active_depth_mask= GL_TRUE;
 
 GLint active_framebuffer= 0;
     
@@ -143,9 +153,11 @@ int gl_sizeof( const int size, const GLenum type, const int stride= 0 )
         case GL_HALF_FLOAT:
             length= 2;
             break;
-        case GL_FIXED:
         case GL_INT_2_10_10_10_REV:
         case GL_UNSIGNED_INT_2_10_10_10_REV:
+            // packed types, 4 components in 4 bytes
+            return 4;
+        case GL_FIXED:
         case GL_UNSIGNED_INT:
         case GL_INT:
             length= 4;
@@ -165,6 +177,204 @@ int gl_sizeof( const int size, const GLenum type, const int stride= 0 )
 }
 
 
+//! read the indices used by the draw call, converted to a triangle list, returns the number of triangles or -1.
+int get_draw_triangles( const draw_call& params, std::vector<unsigned int>& triangles )
+{
+    triangles.clear();
+    if(params.primitive != GL_TRIANGLES 
+    && params.primitive != GL_TRIANGLE_STRIP 
+    && params.primitive != GL_TRIANGLE_FAN)
+        return -1;      // not triangles
+    if(params.count < 3)
+        return 0;
+    
+    std::vector<unsigned int> indices(params.count);
+    if(params.index_type == 0)
+    {
+        for(int i= 0; i < params.count; i++)
+            indices[i]= params.first + i;
+    }
+    else
+    {
+        if(active_index_buffer == 0)
+            return -1;
+        
+        // read back the index buffer, without changing the element array binding of the application vertex array
+        int size= gl_sizeof(1, params.index_type);
+        std::vector<unsigned char> data(params.count * size);
+        glBindBuffer(GL_COPY_READ_BUFFER, active_index_buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, params.index_offset, data.size(), &data.front());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        
+        for(int i= 0; i < params.count; i++)
+        {
+            if(params.index_type == GL_UNSIGNED_BYTE)
+                indices[i]= data[i];
+            else if(params.index_type == GL_UNSIGNED_SHORT)
+                indices[i]= ((const GLushort *) &data.front())[i];
+            else
+                indices[i]= ((const GLuint *) &data.front())[i];
+        }
+    }
+    
+    if(params.primitive == GL_TRIANGLES)
+    {
+        indices.resize(params.count / 3 * 3);
+        triangles.swap(indices);
+    }
+    else
+    {
+        triangles.reserve((params.count - 2) * 3);
+        for(int i= 2; i < params.count; i++)
+        {
+            if(params.primitive == GL_TRIANGLE_FAN)
+            {
+                triangles.push_back(indices[0]);
+                triangles.push_back(indices[i-1]);
+                triangles.push_back(indices[i]);
+            }
+            else
+            {
+                // keep strip triangles orientation
+                triangles.push_back(indices[i-2]);
+                triangles.push_back((i & 1) ? indices[i] : indices[i-1]);
+                triangles.push_back((i & 1) ? indices[i-1] : indices[i]);
+            }
+        }
+    }
+    
+    return (int) triangles.size() / 3;
+}
+
+
+//! simulated post transform vertex cache sizes.
+int vertex_cache_fifo_size= 16;
+int vertex_cache_lru_size= 32;
+
+//! generation counter of buffers, bumped by the application, when the content of a buffer changes.
+std::map<GLuint, unsigned int> buffer_generations;
+
+struct vertex_cache_result
+{
+    GLint buffer;
+    GLint64 offset;
+    GLsizei count;
+    GLenum type;
+    GLenum primitive;
+    GLint64 length;
+    unsigned int generation;
+    unsigned int last_use;      //!< vertex_cache_clock of the last report
+    
+    vertex_cache_stats fifo;
+    vertex_cache_stats lru;
+    
+    bool match( const draw_call& params, const GLint64 _length, const unsigned int _generation ) const
+    {
+        return buffer == active_index_buffer 
+            && offset == params.index_offset 
+            && count == params.count
+            && type == params.index_type
+            && primitive == params.primitive
+            && length == _length
+            && generation == _generation
+            && fifo.cache_size == vertex_cache_fifo_size
+            && lru.cache_size == vertex_cache_lru_size;
+    }
+};
+
+//! at most VERTEX_CACHE_RESULTS_MAX cached results, the least recently used is replaced.
+enum { VERTEX_CACHE_RESULTS_MAX= 64 };
+std::vector<vertex_cache_result> vertex_cache_results;
+unsigned int vertex_cache_clock= 0;
+
+//! simulates fifo and lru post transform vertex caches for the indices used by the draw call.
+int report_vertex_cache( const draw_call& params )
+{
+    if(params.index_type == 0 || active_index_buffer == 0)
+        return 0;
+    if(vertex_cache_fifo_size <= 0 && vertex_cache_lru_size <= 0)
+        return 0;
+    
+    GLint64 length= 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, active_index_buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &length);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    
+    unsigned int generation= 0;
+    std::map<GLuint, unsigned int>::const_iterator found= buffer_generations.find(active_index_buffer);
+    if(found != buffer_generations.end())
+        generation= found->second;
+    
+    // look up results
+    int hit= -1;
+    for(int i= 0; i < (int) vertex_cache_results.size(); i++)
+        if(vertex_cache_results[i].match(params, length, generation))
+        {
+            hit= i;
+            break;
+        }
+    
+    if(hit < 0)
+    {
+        // cache miss, read back indices and run the simulations
+        std::vector<unsigned int> triangles;
+        if(get_draw_triangles(params, triangles) <= 0)
+            return -1;
+        
+        vertex_cache_result result;
+        result.buffer= active_index_buffer;
+        result.offset= params.index_offset;
+        result.count= params.count;
+        result.type= params.index_type;
+        result.primitive= params.primitive;
+        result.length= length;
+        result.generation= generation;
+        result.fifo= simulate_vertex_cache(&triangles.front(), (int) triangles.size(), VERTEX_CACHE_FIFO, vertex_cache_fifo_size);
+        result.lru= simulate_vertex_cache(&triangles.front(), (int) triangles.size(), VERTEX_CACHE_LRU, vertex_cache_lru_size);
+        
+        // replace previous results for the same index range
+        for(int i= 0; i < (int) vertex_cache_results.size(); i++)
+            if(vertex_cache_results[i].buffer == result.buffer 
+            && vertex_cache_results[i].offset == result.offset 
+            && vertex_cache_results[i].count == result.count)
+            {
+                hit= i;
+                break;
+            }
+        
+        if(hit < 0 && (int) vertex_cache_results.size() < VERTEX_CACHE_RESULTS_MAX)
+        {
+            hit= (int) vertex_cache_results.size();
+            vertex_cache_results.push_back(result);
+        }
+        else
+        {
+            // or the least recently used results
+            if(hit < 0)
+            {
+                hit= 0;
+                for(int i= 1; i < (int) vertex_cache_results.size(); i++)
+                    if(vertex_cache_clock - vertex_cache_results[i].last_use > vertex_cache_clock - vertex_cache_results[hit].last_use)
+                        hit= i;
+            }
+            vertex_cache_results[hit]= result;
+        }
+    }
+    
+    vertex_cache_results[hit].last_use= vertex_cache_clock++;
+    const vertex_cache_result& result= vertex_cache_results[hit];
+    WARNING("post transform vertex cache, index buffer object %d, offset %lu, count %d: %d triangles, %d vertices\n", 
+        result.buffer, (unsigned long) result.offset, result.count, result.fifo.triangles, result.fifo.vertices);
+    if(result.fifo.cache_size > 0)
+        WARNING("  fifo %d: %d transformed vertices, acmr %.3f, atvr %.3f\n", 
+            result.fifo.cache_size, result.fifo.misses, result.fifo.acmr, result.fifo.atvr);
+    if(result.lru.cache_size > 0)
+        WARNING("  lru %d: %d transformed vertices, acmr %.3f, atvr %.3f\n", 
+            result.lru.cache_size, result.lru.misses, result.lru.acmr, result.lru.atvr);
+    return 0;
+}
+
+
 int get_active_program_stages( )
 {
     active_program= 0;
@@ -253,7 +463,8 @@ const char *display_fragment_source= {
 };
 
 //! create a shader program using active shaders, \param mask indicates which shaders to attach.
-GLuint create_display_program( unsigned int mask, const char *fragment_source )
+//! \param feedback, optional varying captured with transform feedback.
+GLuint create_display_program( unsigned int mask, const char *fragment_source, const char *feedback= NULL )
 {
     if(mask == 0 || fragment_source == NULL)
         return 0;
@@ -300,6 +511,9 @@ GLuint create_display_program( unsigned int mask, const char *fragment_source )
     for(int i= 0; i < active_attribute_count; i++)
         glBindAttribLocation(program, i, &active_attributes[i].name.front());
     
+    if(feedback != NULL)
+        glTransformFeedbackVaryings(program, 1, &feedback, GL_SEPARATE_ATTRIBS);
+    
     // link display program
     if(link_program(program) < 0)
     {
@@ -318,6 +532,7 @@ struct program
     GLuint name;
     std::vector<GLuint> stages;
     const char *fragment_source;        //!< references a static string, nothing to free
+    const char *feedback;       //!< references a static string, nothing to free
     unsigned int mask;
     
     program( )
@@ -325,25 +540,29 @@ struct program
         name(0),
         stages(MAX_STAGES, 0),
         fragment_source(NULL),
+        feedback(NULL),
         mask(0)
     {}
     
-    program( const GLuint _name, const unsigned int _mask, const std::vector<GLuint>& _stages, const char *_fragment_source )
+    program( const GLuint _name, const unsigned int _mask, const std::vector<GLuint>& _stages, const char *_fragment_source, const char *_feedback )
         :
         name(_name),
         stages(_stages),
         fragment_source(_fragment_source),
+        feedback(_feedback),
         mask(_mask)
     {}
     
     ~program( ) {}
     
-    bool match( const unsigned int _mask, const std::vector<GLuint>& _stages, const char *_fragment_source ) const
+    bool match( const unsigned int _mask, const std::vector<GLuint>& _stages, const char *_fragment_source, const char *_feedback ) const
     {
         if(_mask != mask)
             return false;
         if(_fragment_source != fragment_source) // static strings required
             return false;
+        if(_feedback != feedback)
+            return false;
         
         // mask and display source match, check shader objects
         if(_stages.size() != MAX_STAGES)
@@ -363,7 +582,7 @@ struct program
 std::vector<program> program_cache;
 
 //! program cache, retrieve an already built shader program or create a new one
-GLuint cache_get_display_program( unsigned int mask, const char *fragment_source )
+GLuint cache_get_display_program( unsigned int mask, const char *fragment_source, const char *feedback= NULL )
 {
     // build required shader state
     std::vector<GLuint> stages(MAX_STAGES, 0);
@@ -374,16 +593,16 @@ GLuint cache_get_display_program( unsigned int mask, const char *fragment_source
     // look up program 
     int count= (int) program_cache.size();
     for(int i= 0; i < count; i++)
-        if(program_cache[i].match(mask, stages, fragment_source))
+        if(program_cache[i].match(mask, stages, fragment_source, feedback))
             return program_cache[i].name;    // hit
     
     // cache miss, build a new program
-    GLuint program_name= create_display_program(mask, fragment_source);
+    GLuint program_name= create_display_program(mask, fragment_source, feedback);
     if(program_name == 0)
         return 0;
     
     // cache the new program
-    program_cache.push_back( program(program_name, mask, stages, fragment_source) );
+    program_cache.push_back( program(program_name, mask, stages, fragment_source, feedback) );
     return program_name;
 }
     
@@ -532,6 +751,116 @@ int get_active_buffer_bindings( )
 }
 
 
+//! triangles and clip space positions used by the inspected draw, read back once per debug draw call.
+std::vector<unsigned int> active_triangles;
+int active_triangle_count= 0;
+bool active_triangles_valid= false;
+
+std::vector<float> active_clip_positions;
+GLint active_clip_first= 0;
+int active_clip_count= 0;
+bool active_clip_positions_valid= false;
+
+GLuint clip_feedback_buffer= 0;
+
+void reset_active_draw_data( )
+{
+    active_triangles_valid= false;
+    active_clip_positions_valid= false;
+}
+
+//! returns the number of triangles of the draw call, or -1, triangles are stored in active_triangles.
+int get_active_triangles( const draw_call& params )
+{
+    if(active_triangles_valid == false)
+    {
+        active_triangle_count= get_draw_triangles(params, active_triangles);
+        active_triangles_valid= true;
+    }
+    
+    return active_triangle_count;
+}
+
+//! captures the vertex shader gl_Position of the vertices used by the draw call, returns the number of vertices, or -1.
+//! clip space positions are stored in active_clip_positions, 4 floats per vertex, starting with vertex active_clip_first.
+int get_active_clip_positions( const draw_call& params )
+{
+    if(active_clip_positions_valid)
+        return active_clip_count;
+    
+    active_clip_positions_valid= true;
+    active_clip_count= -1;
+    active_clip_positions.clear();
+    
+    if(get_active_triangles(params) <= 0)
+        return -1;
+    if(find_active_shader(GL_VERTEX_SHADER) == 0)
+        return -1;
+    
+    GLuint feedback_program= cache_get_display_program( VERTEX_STAGE_BIT, display_fragment_source, "gl_Position" );
+    if(feedback_program == 0)
+    {
+        ERROR("error building clip space feedback shader program. failed.\n");
+        return -1;
+    }
+    
+    if(clip_feedback_buffer == 0)
+        glGenBuffers(1, &clip_feedback_buffer);
+    if(clip_feedback_buffer == 0)
+        return -1;
+    
+    // vertex range used by the draw
+    unsigned int first= *std::min_element(active_triangles.begin(), active_triangles.end());
+    unsigned int last= *std::max_element(active_triangles.begin(), active_triangles.end());
+    GLint count= last - first +1;
+    
+    GLint active_feedback_buffer= 0;
+    GLint64 active_feedback_offset= 0;
+    GLint64 active_feedback_length= 0;
+    glGetIntegeri_v(GL_TRANSFORM_FEEDBACK_BUFFER_BINDING, 0, &active_feedback_buffer);
+    if(active_feedback_buffer > 0)
+    {
+        glGetInteger64i_v(GL_TRANSFORM_FEEDBACK_BUFFER_START, 0, &active_feedback_offset);
+        glGetInteger64i_v(GL_TRANSFORM_FEEDBACK_BUFFER_SIZE, 0, &active_feedback_length);
+    }
+    
+    // resize feedback buffer, use array_buffer target (bug on ati)
+    GLint64 length= count * sizeof(float [4]);
+    GLint64 feedback_length= 0;
+    glBindBuffer(GL_ARRAY_BUFFER, clip_feedback_buffer);
+    glGetBufferParameteri64v(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &feedback_length);
+    if(feedback_length < length)
+        glBufferData(GL_ARRAY_BUFFER, length, NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, active_vertex_buffer);
+    
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, clip_feedback_buffer);
+    
+    // run the application vertex shader on the vertex range
+    glBindVertexArray(active_vertex_array);
+    glUseProgram(feedback_program);
+    assign_program_uniforms(feedback_program, active_program);
+    
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, first, count);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    
+    active_clip_positions.resize(count * 4);
+    glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, length, &active_clip_positions.front());
+    
+    // restore previous transform feedback 
+    if(active_feedback_buffer == 0 || active_feedback_length == 0)
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, active_feedback_buffer);
+    else
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, active_feedback_buffer, active_feedback_offset, active_feedback_length);
+    
+    active_clip_first= first;
+    active_clip_count= count;
+    return count;
+}
+
+
 const char *attribute_vertex_source= {
 "   #version 330\n\
     uniform mat4 mvpMatrix;\n\
@@ -606,17 +935,38 @@ int draw_attribute( const int id, const draw_call& draw_params )
     glGetBufferParameteri64v(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &feedback_length);
 
     GLint64 stride = active_buffers[id].stride;
-    GLint64 count= (active_buffers[id].length - active_buffers[id].offset) / stride;
+    GLint64 capacity= (active_buffers[id].length - active_buffers[id].offset) / stride;
     
-    WARNING("  vertex buffer object %d: length %lu, stride %lu, offset %lu, count %d\n", active_buffers[id].buffer, 
-        active_buffers[id].length, stride, active_buffers[id].offset, count);
+    // vertex range used by the draw, not the whole buffer: it may store other meshes, when suballocated.
+    // vertices are numbered from the attribute offset
+    GLint64 first= 0;
+    GLint64 count= capacity;
+    if(get_active_triangles(draw_params) > 0)
+    {
+        first= *std::min_element(active_triangles.begin(), active_triangles.end());
+        count= *std::max_element(active_triangles.begin(), active_triangles.end()) - first +1;
+    }
+    else if(draw_params.index_type == 0)
+    {
+        first= draw_params.first;
+        count= draw_params.count;
+    }
+    count= std::min(count, capacity - first);
+    
+    WARNING("  vertex buffer object %d: length %lu, stride %lu, offset %lu, first %d, count %d\n", active_buffers[id].buffer, 
+        active_buffers[id].length, stride, active_buffers[id].offset, (int) first, (int) count);
+    if(count <= 0)
+    {
+        WARNING("  vertex range outside of the buffer. failed\n");
+        glBindBuffer(GL_ARRAY_BUFFER, active_vertex_buffer);
+        return 0;
+    }
     
     // store count vec3s
     GLint64 length= count * sizeof(float [3]);
     if(feedback_length < length)
     {
-        std::vector<unsigned char> zeroes(length, 0);
-        glBufferData(GL_ARRAY_BUFFER, length, &zeroes.front(), GL_DYNAMIC_COPY);
+        glBufferData(GL_ARRAY_BUFFER, length, NULL, GL_DYNAMIC_COPY);
         //~ WARNING("  resize feedback buffer: %d < %d\n", feedback_length, length);
     }
     
@@ -646,7 +996,6 @@ int draw_attribute( const int id, const draw_call& draw_params )
     glEnable(GL_RASTERIZER_DISCARD);
     glUseProgram(attribute_program);
     
-    GLint64 first= active_buffers[id].offset / stride;
     glBeginTransformFeedback(GL_POINTS);
     glDrawArrays(GL_POINTS, first, count);
     glEndTransformFeedback();
@@ -664,27 +1013,15 @@ int draw_attribute( const int id, const draw_call& draw_params )
         glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, active_feedback_buffer, active_feedback_offset, active_feedback_length);
     
     // compute bbox
-    Point bmin( std::numeric_limits<float>::infinity() );
-    Point bmax( - std::numeric_limits<float>::infinity() );
-    for(int i= 0; i < count; i++)
-    {
-        Point p( positions[3*i], positions[3*i+1], positions[3*i+2] );
-        
-        bmin.x= std::min(p.x, bmin.x);
-        bmin.y= std::min(p.y, bmin.y);
-        bmin.z= std::min(p.z, bmin.z);
-        
-        bmax.x= std::max(p.x, bmax.x);
-        bmax.y= std::max(p.y, bmax.y);
-        bmax.z= std::max(p.z, bmax.z);
-    }
-    
-    WARNING("  bbox (%f %f %f) (%f %f %f)\n", bmin.x, bmin.y, bmin.z, bmax.x, bmax.y, bmax.z);
+    BBox bounds(&positions.front(), count);
+    WARNING("  bbox (%f %f %f) (%f %f %f)\n", 
+        bounds.pMin.x, bounds.pMin.y, bounds.pMin.z, bounds.pMax.x, bounds.pMax.y, bounds.pMax.z);
     
     // compute a sensible transform to display the data
     float fov= 25.f;
-    Point center= (bmin + bmax) * .5f;
-    float radius= Distance(center, bmax);
+    Point center;
+    float radius;
+    bounds.BoundingSphere(center, radius);
     float distance= radius / tanf(fov / 180.f * M_PI);
     
     Transform view= LookAt( Point(0.f, 0.f, distance), center, Vector(0.f, 1.f, 0.f) );
@@ -738,6 +1075,195 @@ int draw_attribute( const char *name, const draw_call& params )
 }
 
 
+//! clusters declared by the application, cf. DebugDrawClusters( ).
+GLuint active_cluster_buffer= 0;
+int active_cluster_count= 0;
+GLint64 active_cluster_index_offset= 0;  //!< byte offset of the first index of the mesh, cluster ranges are relative to it
+bool active_cluster_mvp_valid= false;
+Matrix4x4 active_cluster_mvp;
+
+//! host copy of the cluster buffer, read back when the buffer changes.
+std::vector<DebugCluster> clusters;
+GLuint clusters_buffer= 0;
+unsigned int clusters_generation= 0;
+
+//! returns the number of clusters declared by the application, stored in clusters.
+int get_active_clusters( )
+{
+    if(active_cluster_buffer == 0 || active_cluster_count <= 0)
+        return 0;
+    
+    unsigned int generation= 0;
+    std::map<GLuint, unsigned int>::const_iterator found= buffer_generations.find(active_cluster_buffer);
+    if(found != buffer_generations.end())
+        generation= found->second;
+    
+    if(clusters_buffer != active_cluster_buffer 
+    || clusters_generation != generation 
+    || (int) clusters.size() != active_cluster_count)
+    {
+        clusters.resize(active_cluster_count);
+        glBindBuffer(GL_COPY_READ_BUFFER, active_cluster_buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, active_cluster_count * sizeof(DebugCluster), &clusters.front());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        
+        clusters_buffer= active_cluster_buffer;
+        clusters_generation= generation;
+    }
+    
+    return (int) clusters.size();
+}
+
+
+const char *cluster_fragment_source= {
+"   #version 330\n\
+    uniform vec4 debug_cluster_color;\n\
+    layout(location= 0) out vec4 fragment_color;\n\
+    void main( ) {\n\
+        if(gl_FrontFacing)\n\
+            fragment_color= debug_cluster_color;\n\
+        else\n\
+            fragment_color= vec4(debug_cluster_color.rgb * .5f, 1.f);\n\
+    }\n\
+"
+};
+
+//! draws each cluster overlapping the index range of the draw call with a different color, program must be in use.
+int draw_clusters( const draw_call& draw_params, const GLuint program )
+{
+    const unsigned int size= gl_sizeof(1, draw_params.index_type);
+    const unsigned int begin= (unsigned int) ((draw_params.index_offset - active_cluster_index_offset) / size);
+    const unsigned int end= begin + draw_params.count;
+    
+    GLint location= glGetUniformLocation(program, "debug_cluster_color");
+    for(unsigned int i= 0; i < clusters.size(); i++)
+    {
+        unsigned int first= std::max(begin, clusters[i].first);
+        unsigned int last= std::min(end, clusters[i].first + clusters[i].count);
+        if(first >= last)
+            continue;
+        
+        // hashed color
+        unsigned int hash= (i +1) * 2654435761u;
+        glUniform4f(location, 
+            .3f + .7f * (float) ((hash >> 8) & 255) / 255.f, 
+            .3f + .7f * (float) ((hash >> 16) & 255) / 255.f, 
+            .3f + .7f * (float) ((hash >> 24) & 255) / 255.f, 
+            1.f);
+        
+        glDrawElements(draw_params.primitive, last - first, draw_params.index_type, 
+            (const GLvoid *) (active_cluster_index_offset + (GLint64) first * size));
+    }
+    
+    return 0;
+}
+
+//! counts clusters outside the frustum, or back facing according to their normal cone, for the application mvp matrix.
+int report_cluster_culling( const draw_call& draw_params )
+{
+    if(active_cluster_mvp_valid == false || get_active_clusters() == 0)
+        return 0;
+    
+    const Matrix4x4& m= active_cluster_mvp;
+    
+    // bounding spheres against the frustum planes, 4 clusters at a time
+    const Frustum frustum(m);
+    std::vector<unsigned int> visible((clusters.size() + 31) / 32);
+    frustum.visibleSpheres(clusters[0].center, (int) clusters.size(), &visible.front(), sizeof(DebugCluster));
+    
+    // camera position: maps to clip space (0, 0, z, 0), or view direction for an orthographic projection
+    Matrix4x4 inv= m.getInverse();
+    float eye[4]= { inv.m[0][2], inv.m[1][2], inv.m[2][2], inv.m[3][2] };
+    bool perspective= (fabsf(eye[3]) > 1e-6f);
+    if(perspective)
+        for(int k= 0; k < 3; k++)
+            eye[k]/= eye[3];
+    
+    const unsigned int size= gl_sizeof(1, draw_params.index_type);
+    const unsigned int begin= (unsigned int) ((draw_params.index_offset - active_cluster_index_offset) / size);
+    const unsigned int end= begin + draw_params.count;
+    
+    int count= 0;
+    int outside= 0;
+    int back= 0;
+    int triangles= 0;
+    int outside_triangles= 0;
+    for(unsigned int i= 0; i < clusters.size(); i++)
+    {
+        const DebugCluster& cluster= clusters[i];
+        if(cluster.first >= end || cluster.first + cluster.count <= begin)
+            continue;
+        count++;
+        triangles+= cluster.count / 3;
+        
+        if((visible[i / 32] & (1u << (i % 32))) == 0)
+        {
+            outside++;
+            outside_triangles+= cluster.count / 3;
+            continue;
+        }
+        
+        if(cluster.cone_cutoff > 1.f)
+            continue;
+        
+        float d[3];
+        for(int k= 0; k < 3; k++)
+            d[k]= perspective ? cluster.cone_apex[k] - eye[k] : eye[k];
+        float length= sqrtf(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+        if(length > 0.f 
+        && (d[0] * cluster.cone_axis[0] + d[1] * cluster.cone_axis[1] + d[2] * cluster.cone_axis[2]) >= cluster.cone_cutoff * length)
+            back++;
+    }
+    
+    WARNING("  %d clusters: %d outside the frustum, %d back facing (normal cone), %d visible\n", 
+        count, outside, back, count - outside - back);
+    if(triangles > 0)
+        WARNING("  %d triangles submitted, %d off-screen (%.1f%%)\n", 
+            triangles, outside_triangles, 100.f * (float) outside_triangles / (float) triangles);
+    return 0;
+}
+
+
+//! displays the screen space triangle size histogram at the bottom of the vertex stage panel.
+int draw_triangle_size_histogram( const draw_call& draw_params )
+{
+    if(get_active_clip_positions(draw_params) <= 0)
+        return -1;
+    
+    triangle_size_stats stats= triangle_size_histogram(&active_clip_positions.front(), active_clip_first, 
+        &active_triangles.front(), (int) active_triangles.size(), active_viewport);
+    
+    WARNING("  triangle size: %d triangles, %.1f%% < 1 pixel, %.1f%% < 16 pixels, %d crossing the w= 0 plane\n", 
+        stats.triangles, stats.subpixel * 100.f, stats.small * 100.f, stats.clipped);
+    
+    // one bar per bin, red: sub pixel triangles, orange: less than 16 pixels
+    int max= 1;
+    for(int i= 0; i < triangle_size_stats::BINS; i++)
+        max= std::max(max, stats.bins[i]);
+    
+    const int width= 256 / triangle_size_stats::BINS;
+    for(int i= 0; i < triangle_size_stats::BINS; i++)
+    {
+        int height= stats.bins[i] * 64 / max;
+        if(stats.bins[i] > 0 && height == 0)
+            height= 1;
+        
+        if(i == 0)
+            glClearColor( 1.f, 0.f, 0.f, 1.f );
+        else if(i <= 4)
+            glClearColor( 1.f, .5f, 0.f, 1.f );
+        else
+            glClearColor( 0.f, .7f, 0.f, 1.f );
+        
+        glScissor(256 + 2 + i * width, 2, width - 2, height);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    
+    glScissor(256, 0, 256, 256);
+    return 0;
+}
+
+
 int draw_vertex_stage( const draw_call& draw_params )
 {
     glViewport(256, 0, 256, 256);
@@ -774,7 +1300,22 @@ int draw_vertex_stage( const draw_call& draw_params )
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     glDisable(GL_CULL_FACE);
     
-    draw(draw_params);
+    GLuint cluster_program= 0;
+    if(draw_params.index_type != 0 && get_active_clusters() > 0)
+        cluster_program= cache_get_display_program( VERTEX_STAGE_BIT, cluster_fragment_source );
+    
+    if(cluster_program == 0)
+        draw(draw_params);
+    else
+    {
+        // display clusters
+        glUseProgram(cluster_program);
+        assign_program_uniforms(cluster_program, active_program);
+        draw_clusters(draw_params, cluster_program);
+        report_cluster_culling(draw_params);
+    }
+    
+    draw_triangle_size_histogram(draw_params);
     
     WARNING("  done.\n");
     return 0;
@@ -825,12 +1366,42 @@ int draw_geometry_stage( const draw_call& draw_params )
 }
 
 
+//! classifies the triangles of the draw call on the cpu: outside the frustum, back facing, degenerate.
+int report_culling( const draw_call& draw_params )
+{
+    if(get_active_clip_positions(draw_params) <= 0)
+        return -1;
+    
+    unsigned int cull_mode= 0;
+    if(active_cull_face_mode == GL_BACK || active_cull_face_mode == GL_FRONT_AND_BACK)
+        cull_mode|= CULL_BACK_BIT;
+    if(active_cull_face_mode == GL_FRONT || active_cull_face_mode == GL_FRONT_AND_BACK)
+        cull_mode|= CULL_FRONT_BIT;
+    
+    culling_stats stats= classify_triangles(&active_clip_positions.front(), active_clip_first, 
+        &active_triangles.front(), (int) active_triangles.size(), cull_mode, active_front_face == GL_CCW);
+    
+    const float scale= (stats.triangles > 0) ? 100.f / (float) stats.triangles : 0.f;
+    WARNING("  %d triangles: %d outside the frustum (%.1f%%), %d %s (%.1f%%), %d degenerate (%.1f%%), %d visible (%d clipped)\n", 
+        stats.triangles, 
+        stats.outside, stats.outside * scale, 
+        stats.culled, active_cull_test ? "culled" : "would be culled", stats.culled * scale, 
+        stats.degenerate, stats.degenerate * scale, 
+        stats.visible, stats.clipped);
+    return 0;
+}
+
+
 int draw_culling_stage( const draw_call& draw_params )
 {
     glViewport(768, 0, 256, 256);
     glScissor(768, 0, 256, 256);
     glEnable(GL_SCISSOR_TEST);
     
+    // what the rasterizer culls, and what could be culled before drawing
+    WARNING("culling analysis:\n");
+    report_culling(draw_params);
+    
     bool todo= true;
     if(active_cull_test == GL_FALSE)
         // nothing to do when culling is disabled
@@ -930,6 +1501,332 @@ int draw_fragment_stage( const draw_call& draw_params )
     return 0;    
 }
 
+
+//! early depth rejection blockers found in a fragment shader source.
+enum {
+    EARLY_Z_FRAG_DEPTH_BIT= 1,  //!< writes gl_FragDepth
+    EARLY_Z_DISCARD_BIT= 2,     //!< uses discard
+    EARLY_Z_IMAGE_STORE_BIT= 4, //!< imageStore( ) / imageAtomic*( )
+    EARLY_Z_BUFFER_STORE_BIT= 8,        //!< writable shader storage block or atomic counter
+    EARLY_Z_FORCED_BIT= 16      //!< layout(early_fragment_tests) in;
+};
+
+struct early_z_blocker
+{
+    unsigned int bit;
+    const char *token;
+    const char *description;
+};
+
+early_z_blocker early_z_blockers[]= {
+    { EARLY_Z_FRAG_DEPTH_BIT, "gl_FragDepth", "writes gl_FragDepth" },
+    { EARLY_Z_DISCARD_BIT, "discard", "uses discard" },
+    { EARLY_Z_IMAGE_STORE_BIT, "imageStore", "writes an image" },
+    { EARLY_Z_IMAGE_STORE_BIT, "imageAtomic", "writes an image (atomic)" },
+    { EARLY_Z_BUFFER_STORE_BIT, "buffer", "declares a shader storage block" },
+    { EARLY_Z_BUFFER_STORE_BIT, "atomicCounterIncrement", "increments an atomic counter" },
+    { EARLY_Z_BUFFER_STORE_BIT, "atomicCounterDecrement", "decrements an atomic counter" },
+    { EARLY_Z_FORCED_BIT, "early_fragment_tests", "forces early fragment tests" },
+    { 0, NULL, NULL }
+};
+
+static
+bool is_identifier( const char c )
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+//! returns true if the identifier word appears in [begin, end).
+static
+bool find_identifier( const char *begin, const char *end, const char *word )
+{
+    const int n= (int) strlen(word);
+    for(const char *p= begin; p + n <= end; p++)
+        if((p == begin || !is_identifier(p[-1])) && strncmp(p, word, n) == 0 && (p + n == end || !is_identifier(p[n])))
+            return true;
+    return false;
+}
+
+//! returns true if the storage block declared by the buffer keyword at source[i] can't be written: 
+//! readonly in the qualifiers before buffer, in any order, or readonly members only.
+static
+bool is_readonly_block( const std::vector<GLchar>& source, const int i )
+{
+    // qualifiers, identifiers and layout( ), up to the previous declaration
+    int j= i;
+    for(;;)
+    {
+        while(j > 0 && isspace(source[j-1]))
+            j--;
+        if(j > 0 && source[j-1] == ')')
+        {
+            while(j > 0 && source[j-1] != '(')
+                j--;
+            if(j > 0)
+                j--;
+            continue;
+        }
+        if(j == 0 || !is_identifier(source[j-1]))
+            break;
+        
+        const int end= j;
+        while(j > 0 && is_identifier(source[j-1]))
+            j--;
+        if(find_identifier(&source[j], &source[end], "readonly"))
+            return true;
+    }
+    
+    // block members, between { and }
+    int k= i;
+    while(source[k] != 0 && source[k] != '{' && source[k] != ';')
+        k++;
+    if(source[k] != '{')
+        return false;
+    
+    for(int begin= k +1; source[begin] != 0; )
+    {
+        int end= begin;
+        while(source[end] != 0 && source[end] != ';' && source[end] != '}')
+            end++;
+        
+        // each member declaration is readonly
+        bool empty= true;
+        for(int m= begin; m < end; m++)
+            if(!isspace(source[m]))
+                empty= false;
+        if(!empty && !find_identifier(&source[begin], &source[end], "readonly"))
+            return false;
+        
+        if(source[end] != ';')
+            break;
+        begin= end +1;
+    }
+    
+    return true;
+}
+
+//! returns the #version of a shader source, 110 without #version.
+static
+int get_source_version( const std::vector<GLchar>& source )
+{
+    for(int i= 0; i +8 < (int) source.size() && source[i] != 0; i++)
+        if(source[i] == '#')
+        {
+            int k= i +1;
+            while(source[k] == ' ' || source[k] == '\t')
+                k++;
+            if(strncmp(&source[k], "version", 7) == 0)
+                return atoi(&source[k + 7]);
+        }
+    return 110;
+}
+
+//! scan the fragment shader source for constructs disabling early depth rejection, returns a mask of EARLY_Z_xxx_BIT.
+//! \param lines, first line of each blocker found, indexed like early_z_blockers[].
+unsigned int get_early_z_blockers( const GLuint shader, std::vector<int>& lines )
+{
+    lines.assign(sizeof(early_z_blockers) / sizeof(early_z_blocker), 0);
+    if(shader == 0)
+        return 0;
+    
+    GLint length= 0;
+    glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+    if(length == 0)
+        return 0;
+    
+    std::vector<GLchar> source(length, 0);
+    glGetShaderSource(shader, length, NULL, &source.front());
+    
+    // strip comments, keep line breaks to report line numbers
+    for(int i= 0; i +1 < length && source[i] != 0; i++)
+    {
+        if(source[i] == '/' && source[i+1] == '/')
+        {
+            for(; i < length && source[i] != 0 && source[i] != '\n'; i++)
+                source[i]= ' ';
+        }
+        else if(source[i] == '/' && source[i+1] == '*')
+        {
+            for(; i +1 < length && source[i] != 0 && !(source[i] == '*' && source[i+1] == '/'); i++)
+                if(source[i] != '\n')
+                    source[i]= ' ';
+            if(i +1 < length && source[i] != 0)
+            {
+                source[i]= ' ';
+                source[i+1]= ' ';
+            }
+        }
+    }
+    
+    const int version= get_source_version(source);
+    unsigned int mask= 0;
+    int line= 1;
+    for(int i= 0; i < length && source[i] != 0; i++)
+    {
+        if(source[i] == '\n')
+            line++;
+        if(!is_identifier(source[i]) || (i > 0 && is_identifier(source[i-1])))
+            continue;       // not the start of an identifier
+        
+        for(int k= 0; early_z_blockers[k].token != NULL; k++)
+        {
+            const char *token= early_z_blockers[k].token;
+            int n= (int) strlen(token);
+            if(strncmp(&source[i], token, n) != 0)
+                continue;
+            // imageAtomicAdd, etc. match a prefix, other tokens are complete identifiers
+            if(early_z_blockers[k].bit != EARLY_Z_IMAGE_STORE_BIT && is_identifier(source[i + n]))
+                continue;
+            // buffer is a keyword since glsl 430, readonly storage blocks have no side effects
+            if(strcmp(token, "buffer") == 0 && (version < 430 || is_readonly_block(source, i)))
+                continue;
+            
+            mask= mask | early_z_blockers[k].bit;
+            if(lines[k] == 0)
+                lines[k]= line;
+        }
+    }
+    
+    return mask;
+}
+
+
+const char *overdraw_fragment_source= {
+"   #version 330\n\
+    layout(location= 0) out vec4 fragment_color;\n\
+    void main( ) {\n\
+        fragment_color= vec4(.1f, .05f, .02f, 1.f);\n\
+    }\n\
+"
+};
+
+GLuint early_z_queries[2]= { 0, 0 };
+std::vector<GLuint> early_z_reported_shaders;        //!< fragment shaders whose early-z blockers were reported
+
+//! counts fragments rasterized / fragments passing the application depth test, displays overdraw.
+int draw_early_z_stage( const draw_call& draw_params )
+{
+    glViewport(1024, 256, 256, 256);
+    glScissor(1024, 256, 256, 256);
+    glEnable(GL_SCISSOR_TEST);
+    
+    if(glIsEnabled(GL_RASTERIZER_DISCARD) || active_depth_test == GL_FALSE)
+    {
+        // nothing to do, no depth test, display a solid color background ?
+        glClearColor( .5f, 0.f, .5f, 1.f );
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        return 0;
+    }
+    
+    WARNING("draw_early_z_stage( ):\n");
+    
+    std::vector<int> lines;
+    const GLuint fragment_shader= find_active_shader(GL_FRAGMENT_SHADER);
+    unsigned int blockers= get_early_z_blockers(fragment_shader, lines);
+    
+    if(early_z_queries[0] == 0)
+        glGenQueries(2, early_z_queries);
+    if(early_z_queries[0] == 0)
+        return -1;
+    
+    glUseProgram(active_program);
+    glPolygonMode(GL_FRONT_AND_BACK, active_polygon_modes[0]);
+    if(active_cull_test == 0)
+        glDisable(GL_CULL_FACE);
+    else
+        glEnable(GL_CULL_FACE);
+    
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    
+    // count all rasterized fragments, ie shaded fragments without early depth rejection
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glDepthFunc(GL_ALWAYS);
+    glBeginQuery(GL_SAMPLES_PASSED, early_z_queries[0]);
+    draw(draw_params);
+    glEndQuery(GL_SAMPLES_PASSED);
+    
+    // count fragments passing the application depth test, ie shaded fragments with early depth rejection
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glDepthFunc(active_depth_func);
+    glDepthMask(active_depth_mask);
+    glBeginQuery(GL_SAMPLES_PASSED, early_z_queries[1]);
+    draw(draw_params);
+    glEndQuery(GL_SAMPLES_PASSED);
+    
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    
+    // display overdraw, red background when early depth rejection is disabled
+    GLuint overdraw_program= cache_get_display_program( TRANSFORM_STAGES_MASK, overdraw_fragment_source );
+    if((blockers & ~EARLY_Z_FORCED_BIT) != 0 && (blockers & EARLY_Z_FORCED_BIT) == 0)
+        glClearColor( .15f, 0.f, 0.f, 1.f );
+    else
+        glClearColor( .05f, .05f, .05f, 1.f );
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    if(overdraw_program != 0)
+    {
+        GLint active_blend= glIsEnabled(GL_BLEND);
+        GLint active_blend_funcs[4];
+        glGetIntegerv(GL_BLEND_SRC_RGB, &active_blend_funcs[0]);
+        glGetIntegerv(GL_BLEND_DST_RGB, &active_blend_funcs[1]);
+        glGetIntegerv(GL_BLEND_SRC_ALPHA, &active_blend_funcs[2]);
+        glGetIntegerv(GL_BLEND_DST_ALPHA, &active_blend_funcs[3]);
+        GLint active_blend_equations[2];
+        glGetIntegerv(GL_BLEND_EQUATION_RGB, &active_blend_equations[0]);
+        glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &active_blend_equations[1]);
+        
+        glUseProgram(overdraw_program);
+        assign_program_uniforms(overdraw_program, active_program);
+        
+        glDepthFunc(GL_ALWAYS);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBlendEquation(GL_FUNC_ADD);
+        draw(draw_params);
+        
+        glBlendFuncSeparate(active_blend_funcs[0], active_blend_funcs[1], active_blend_funcs[2], active_blend_funcs[3]);
+        glBlendEquationSeparate(active_blend_equations[0], active_blend_equations[1]);
+        if(active_blend == 0)
+            glDisable(GL_BLEND);
+    }
+    
+    GLuint64 shaded= 0;
+    GLuint64 passed= 0;
+    glGetQueryObjectui64v(early_z_queries[0], GL_QUERY_RESULT, &shaded);
+    glGetQueryObjectui64v(early_z_queries[1], GL_QUERY_RESULT, &passed);
+    
+    WARNING("  %lu fragments rasterized, %lu fragments pass the depth test (%.1f%%), overdraw x%.2f\n", 
+        (unsigned long) shaded, (unsigned long) passed, 
+        shaded ? 100.f * (float) passed / (float) shaded : 0.f,
+        passed ? (float) shaded / (float) passed : 0.f);
+    
+    if(blockers & EARLY_Z_FORCED_BIT)
+        WARNING("  early depth rejection forced by the fragment shader.\n");
+    else if(blockers != 0)
+    {
+        // every blocker, once per shader object: the warnings are deduplicated by call site, not by shader
+        if(std::find(early_z_reported_shaders.begin(), early_z_reported_shaders.end(), fragment_shader) == early_z_reported_shaders.end())
+        {
+            early_z_reported_shaders.push_back(fragment_shader);
+            
+            std::string blocker_list;
+            for(int k= 0; early_z_blockers[k].token != NULL; k++)
+                if(lines[k] != 0)
+                    blocker_list.append("\n    ").append(early_z_blockers[k].description)
+                        .append(", line ").append(std::to_string(lines[k]))
+                        .append(" '").append(early_z_blockers[k].token).append("'");
+            MESSAGE("  early depth rejection disabled by fragment shader object %u:%s\n", fragment_shader, blocker_list.c_str());
+        }
+        WARNING("  %lu fragments shaded for nothing.\n", (unsigned long) (shaded - passed));
+    }
+    
+    WARNING("  done.\n");
+    return 0;
+}
+
 }       // namespace debug
 
 
@@ -942,6 +1839,7 @@ void DebugDrawArrays( const GLenum  mode, const GLint first, const GLsizei count
     debug::get_active_program_stages();
     debug::get_active_attributes();
     debug::get_active_buffer_bindings();
+    debug::reset_active_draw_data();
     
     // store draw call parameters
     debug::draw_call params;
@@ -969,8 +1867,14 @@ void DebugDrawArrays( const GLenum  mode, const GLint first, const GLsizei count
     GLint active_scissor_test= glIsEnabled(GL_SCISSOR_TEST);
     
     debug::active_cull_test= glIsEnabled(GL_CULL_FACE);
+    glGetIntegerv(GL_CULL_FACE_MODE, &debug::active_cull_face_mode);
+    glGetIntegerv(GL_FRONT_FACE, &debug::active_front_face);
     glGetIntegerv(GL_POLYGON_MODE, debug::active_polygon_modes);
     
+    debug::active_depth_test= glIsEnabled(GL_DEPTH_TEST);
+    glGetIntegerv(GL_DEPTH_FUNC, &debug::active_depth_func);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &debug::active_depth_mask);
+    
     // display stages
     if(position == NULL)
     {
@@ -983,6 +1887,7 @@ void DebugDrawArrays( const GLenum  mode, const GLint first, const GLsizei count
     debug::draw_geometry_stage(params);
     debug::draw_culling_stage(params);
     debug::draw_fragment_stage(params);
+    debug::draw_early_z_stage(params);
     
     // restore application state
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, debug::active_framebuffer);    
@@ -1002,6 +1907,13 @@ void DebugDrawArrays( const GLenum  mode, const GLint first, const GLsizei count
         glDisable(GL_CULL_FACE);
     else
         glEnable(GL_CULL_FACE);
+    
+    if(debug::active_depth_test == 0)
+        glDisable(GL_DEPTH_TEST);
+    else
+        glEnable(GL_DEPTH_TEST);
+    glDepthFunc(debug::active_depth_func);
+    glDepthMask(debug::active_depth_mask);
 }
 
 void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum type, const GLvoid *indices, const char *position )
@@ -1010,6 +1922,7 @@ void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum typ
     debug::get_active_program_stages();
     debug::get_active_attributes();
     debug::get_active_buffer_bindings();
+    debug::reset_active_draw_data();
     
     // check application bugs
     if(debug::active_index_buffer == 0)
@@ -1054,8 +1967,16 @@ void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum typ
     GLint active_scissor_test= glIsEnabled(GL_SCISSOR_TEST);
     
     debug::active_cull_test= glIsEnabled(GL_CULL_FACE);
+    glGetIntegerv(GL_CULL_FACE_MODE, &debug::active_cull_face_mode);
+    glGetIntegerv(GL_FRONT_FACE, &debug::active_front_face);
     glGetIntegerv(GL_POLYGON_MODE, debug::active_polygon_modes);
     
+    debug::active_depth_test= glIsEnabled(GL_DEPTH_TEST);
+    glGetIntegerv(GL_DEPTH_FUNC, &debug::active_depth_func);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &debug::active_depth_mask);
+    
+    debug::report_vertex_cache(params);
+    
     // display stages    
     if(position == NULL)
     {
@@ -1068,6 +1989,7 @@ void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum typ
     debug::draw_geometry_stage(params);
     debug::draw_culling_stage(params);
     debug::draw_fragment_stage(params);
+    debug::draw_early_z_stage(params);
     
     // restore application state
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, debug::active_framebuffer);
@@ -1087,6 +2009,47 @@ void DebugDrawElements( const GLenum mode, const GLsizei count, const GLenum typ
         glDisable(GL_CULL_FACE);
     else
         glEnable(GL_CULL_FACE);
+    
+    if(debug::active_depth_test == 0)
+        glDisable(GL_DEPTH_TEST);
+    else
+        glEnable(GL_DEPTH_TEST);
+    glDepthFunc(debug::active_depth_func);
+    glDepthMask(debug::active_depth_mask);
 }
     
+void DebugDrawVertexCache( const int fifo_size, const int lru_size )
+{
+    debug::vertex_cache_fifo_size= fifo_size;
+    debug::vertex_cache_lru_size= lru_size;
+}
+
+void DebugDrawClusters( const GLuint buffer, const int count, const float *mvp, const GLint64 index_offset )
+{
+    debug::active_cluster_buffer= buffer;
+    debug::active_cluster_count= (buffer != 0) ? count : 0;
+    debug::active_cluster_index_offset= index_offset;
+    debug::active_cluster_mvp_valid= (mvp != NULL);
+    if(mvp != NULL)
+        debug::active_cluster_mvp= Matrix4x4( (const float (*)[4]) mvp );
+}
+
+void DebugBufferChanged( const GLuint buffer )
+{
+    debug::buffer_generations[buffer]++;
+    
+    // drop the stale vertex cache results of the buffer
+    std::vector<debug::vertex_cache_result>& results= debug::vertex_cache_results;
+    for(int i= 0; i < (int) results.size(); )
+    {
+        if(results[i].buffer == (GLint) buffer)
+        {
+            results[i]= results.back();
+            results.pop_back();
+        }
+        else
+            i++;
+    }
+}
+
 }       // namespace 
@@ -0,0 +1,270 @@
+// jeanclaude.iehl@free.fr
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "DebugDrawAnalysis.h"
+
+
+namespace gk {
+namespace debug {
+
+vertex_cache_stats simulate_vertex_cache( const unsigned int *indices, const int count, const int policy, const int cache_size )
+{
+    vertex_cache_stats stats;
+    stats.policy= policy;
+    stats.cache_size= cache_size;
+    if(indices == NULL || count < 3 || cache_size <= 0)
+        return stats;
+    
+    unsigned int vertex_count= *std::max_element(indices, indices + count) +1;
+    
+    // fifo: a vertex is in the cache if at most cache_size misses happened since it was inserted, itself included.
+    // lru: a vertex is in the cache if less than cache_size different vertices were used since its last use.
+    // both are simulated with a timestamp per vertex, lru also keeps the cache content ordered by last use.
+    std::vector<int> stamps(vertex_count, -1);
+    std::vector<unsigned int> lru;
+    lru.reserve(cache_size +1);
+    
+    int misses= 0;
+    int vertices= 0;
+    for(int i= 0; i < count; i++)
+    {
+        unsigned int v= indices[i];
+        if(stamps[v] < 0)
+            vertices++;
+        
+        if(policy == VERTEX_CACHE_FIFO)
+        {
+            if(stamps[v] < 0 || misses - stamps[v] > cache_size)
+            {
+                stamps[v]= misses;
+                misses++;
+            }
+        }
+        else
+        {
+            std::vector<unsigned int>::iterator found= std::find(lru.begin(), lru.end(), v);
+            if(found != lru.end())
+                lru.erase(found);
+            else
+            {
+                stamps[v]= misses;
+                misses++;
+                if((int) lru.size() == cache_size)
+                    lru.pop_back();
+            }
+            lru.insert(lru.begin(), v);
+        }
+    }
+    
+    stats.triangles= count / 3;
+    stats.vertices= vertices;
+    stats.misses= misses;
+    stats.acmr= (float) misses / (float) stats.triangles;
+    stats.atvr= (float) misses / (float) vertices;
+    return stats;
+}
+
+
+static
+int area_bin( const float area )
+{
+    if(area < 1.f)
+        return 0;
+    
+    int exponent;
+    frexpf(area, &exponent);    // area in [2^(exponent-1), 2^exponent)
+    return std::min(exponent, (int) triangle_size_stats::BINS -1);
+}
+
+//! pixel area of 4 triangles, vertices are stored as x y w in SoA form: a[0..3]= x, a[4..7]= y, a[8..11]= w, etc.
+static
+void triangle_area4( const float *a, const float *b, const float *c, const float scale_x, const float scale_y, float *areas )
+{
+#ifdef __SSE__
+    // projects to window coordinates, viewport offset does not change the area
+    __m128 sx= _mm_set1_ps(scale_x);
+    __m128 sy= _mm_set1_ps(scale_y);
+    
+    __m128 ia= _mm_div_ps(_mm_set1_ps(1.f), _mm_loadu_ps(a + 8));
+    __m128 ib= _mm_div_ps(_mm_set1_ps(1.f), _mm_loadu_ps(b + 8));
+    __m128 ic= _mm_div_ps(_mm_set1_ps(1.f), _mm_loadu_ps(c + 8));
+    
+    __m128 ax= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(a), ia), sx);
+    __m128 ay= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(a + 4), ia), sy);
+    __m128 bx= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(b), ib), sx);
+    __m128 by= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(b + 4), ib), sy);
+    __m128 cx= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(c), ic), sx);
+    __m128 cy= _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(c + 4), ic), sy);
+    
+    // area= | (b - a) x (c - a) | / 2
+    __m128 cross= _mm_sub_ps(
+        _mm_mul_ps(_mm_sub_ps(bx, ax), _mm_sub_ps(cy, ay)), 
+        _mm_mul_ps(_mm_sub_ps(by, ay), _mm_sub_ps(cx, ax)) );
+    __m128 area= _mm_mul_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), cross), _mm_set1_ps(.5f));
+    _mm_storeu_ps(areas, area);
+    
+#else
+    for(int i= 0; i < 4; i++)
+    {
+        float ax= a[i] / a[8 + i] * scale_x;
+        float ay= a[4 + i] / a[8 + i] * scale_y;
+        float bx= b[i] / b[8 + i] * scale_x;
+        float by= b[4 + i] / b[8 + i] * scale_y;
+        float cx= c[i] / c[8 + i] * scale_x;
+        float cy= c[4 + i] / c[8 + i] * scale_y;
+        areas[i]= fabsf((bx - ax) * (cy - ay) - (by - ay) * (cx - ax)) * .5f;
+    }
+#endif
+}
+
+triangle_size_stats triangle_size_histogram( const float *clip_positions, const unsigned int first, 
+    const unsigned int *indices, const int count, const int viewport[4] )
+{
+    triangle_size_stats stats;
+    if(clip_positions == NULL || indices == NULL)
+        return stats;
+    
+    const float scale_x= viewport[2] * .5f;
+    const float scale_y= viewport[3] * .5f;
+    
+    // gather 4 triangles in SoA form, skip triangles crossing the w= 0 plane
+    float a[12], b[12], c[12];
+    float areas[4];
+    int n= 0;
+    for(int i= 0; i + 2 < count; i+= 3)
+    {
+        const float *pa= clip_positions + 4 * (indices[i] - first);
+        const float *pb= clip_positions + 4 * (indices[i +1] - first);
+        const float *pc= clip_positions + 4 * (indices[i +2] - first);
+        if(pa[3] <= 0.f || pb[3] <= 0.f || pc[3] <= 0.f)
+        {
+            stats.clipped++;
+            continue;
+        }
+        
+        a[n]= pa[0]; a[4 + n]= pa[1]; a[8 + n]= pa[3];
+        b[n]= pb[0]; b[4 + n]= pb[1]; b[8 + n]= pb[3];
+        c[n]= pc[0]; c[4 + n]= pc[1]; c[8 + n]= pc[3];
+        n++;
+        
+        if(n == 4)
+        {
+            triangle_area4(a, b, c, scale_x, scale_y, areas);
+            for(int k= 0; k < 4; k++)
+                stats.bins[area_bin(areas[k])]++;
+            stats.triangles+= 4;
+            n= 0;
+        }
+    }
+    
+    if(n > 0)
+    {
+        // pad the last group with copies of its first triangle
+        for(int k= n; k < 4; k++)
+        {
+            a[k]= a[0]; a[4 + k]= a[4]; a[8 + k]= a[8];
+            b[k]= b[0]; b[4 + k]= b[4]; b[8 + k]= b[8];
+            c[k]= c[0]; c[4 + k]= c[4]; c[8 + k]= c[8];
+        }
+        
+        triangle_area4(a, b, c, scale_x, scale_y, areas);
+        for(int k= 0; k < n; k++)
+            stats.bins[area_bin(areas[k])]++;
+        stats.triangles+= n;
+    }
+    
+    if(stats.triangles > 0)
+    {
+        int small= 0;
+        for(int i= 0; i < triangle_size_stats::BINS && i <= 4; i++)
+            small+= stats.bins[i];
+        
+        stats.subpixel= (float) stats.bins[0] / (float) stats.triangles;
+        stats.small= (float) small / (float) stats.triangles;
+    }
+    
+    return stats;
+}
+
+
+//! clipping plane outcode of a clip space position, one bit per plane.
+static
+unsigned int clip_outcode( const float *p )
+{
+    const float w= p[3];
+    unsigned int code= 0;
+    if(p[0] < -w) code|= 1;
+    if(p[0] > w) code|= 2;
+    if(p[1] < -w) code|= 4;
+    if(p[1] > w) code|= 8;
+    if(p[2] < -w) code|= 16;
+    if(p[2] > w) code|= 32;
+    return code;
+}
+
+culling_stats classify_triangles( const float *clip_positions, const unsigned int first, 
+    const unsigned int *indices, const int count, const unsigned int cull_mode, const bool front_ccw )
+{
+    culling_stats stats;
+    if(clip_positions == NULL || indices == NULL)
+        return stats;
+    
+    for(int i= 0; i + 2 < count; i+= 3)
+    {
+        stats.triangles++;
+        const float *a= clip_positions + 4 * (indices[i] - first);
+        const float *b= clip_positions + 4 * (indices[i +1] - first);
+        const float *c= clip_positions + 4 * (indices[i +2] - first);
+        
+        // frustum: trivial reject when all vertices are outside the same plane
+        unsigned int code_a= clip_outcode(a);
+        unsigned int code_b= clip_outcode(b);
+        unsigned int code_c= clip_outcode(c);
+        if((code_a & code_b & code_c) != 0)
+        {
+            stats.outside++;
+            continue;
+        }
+        
+        // orientation in homogeneous coordinates, no projection required, 
+        // cf. "Triangle Scan Conversion using 2D Homogeneous Coordinates", Olano, Greer, 1997
+        // det= w_a w_b w_c * twice the signed area of the projected triangle
+        double det= 
+              (double) a[0] * ((double) b[1] * c[3] - (double) c[1] * b[3])
+            - (double) b[0] * ((double) a[1] * c[3] - (double) c[1] * a[3])
+            + (double) c[0] * ((double) a[1] * b[3] - (double) b[1] * a[3]);
+        
+        // the sign of det gives the orientation, even for vertices behind the camera
+        if(det != 0.0)
+        {
+            bool front= ((det > 0.0) == front_ccw);
+            if((front && (cull_mode & CULL_FRONT_BIT)) || (!front && (cull_mode & CULL_BACK_BIT)))
+            {
+                stats.culled++;
+                continue;
+            }
+        }
+        
+        if(det == 0.0 || indices[i] == indices[i +1] || indices[i] == indices[i +2] || indices[i +1] == indices[i +2])
+        {
+            stats.degenerate++;
+            continue;
+        }
+        
+        stats.visible++;
+        if((code_a | code_b | code_c) != 0)
+            stats.clipped++;
+    }
+    
+    return stats;
+}
+
+}       // namespace debug
+}       // namespace gk
@@ -4,27 +4,86 @@
 #include <cstdarg>
 #include <string>
 #include <cstring>
+#include <cstdint>
 
 #include "Logger.h"
 
 
 namespace gk {
 
+//! extrait le nom de fichier, sans le chemin d'acces.
+static
+const char *file_name( const char *file )
+{
+    const char *separator= strrchr(file, '/');  // unix 
+    if(separator == NULL)
+        separator= strrchr(file, '\\'); // essaye la convention windows
+    
+    if(separator != 0)
+        return separator +1;    // saute le separateur, s'il est defini
+    else
+        return file;
+}
+
+//! formate le prefixe "[fichier:ligne]" d'un message.
+static
+void format_prefix( char *tmp, const size_t size, const char *file, const int line )
+{
+#ifndef _MSC_VER
+    snprintf(tmp, size, "[%s:%d]\t", file_name(file), line);
+#else
+    _snprintf(tmp, size, "[%s:%d]\t", file_name(file), line);
+#endif
+}
+
 Log::Log( )
     :
-    m_slots(),
+    m_tail(0),
+    m_head(0),
+    m_dropped(0),
+    m_dropped_reported(0),
+    m_summary(std::chrono::steady_clock::now()),
     m_output(stdout),
-    m_level(MESSAGE)
-{}
+    m_level(MESSAGE),
+    m_lock(),
+    m_wakeup(),
+    m_flushed(),
+    m_stop(false),
+    m_writer()
+{
+    for(unsigned int i= 0; i < RECORD_COUNT; i++)
+        m_records[i].sequence.store(i, std::memory_order_relaxed);
+    for(unsigned int i= 0; i < SITE_COUNT; i++)
+    {
+        m_sites[i].key.store(0, std::memory_order_relaxed);
+        m_sites[i].count.store(0, std::memory_order_relaxed);
+        m_sites[i].line.store(0, std::memory_order_relaxed);
+        m_sites[i].file.store(NULL, std::memory_order_relaxed);
+        m_sites[i].reported= 0;
+    }
+    
+    m_writer= std::thread(&Log::writer, this);
+}
 
 Log::~Log( )
 {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stop= true;
+    }
+    m_wakeup.notify_one();
+    m_writer.join();
+    
     if(m_output != NULL && m_output != stdout)
         fclose(m_output);
 }
 
 int Log::setOutputFile( const char *filename )
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+    // ecrit les messages en attente dans la sortie courante
+    drain();
+    
     if(m_output != NULL && m_output != stdout)
         fclose(m_output);
     
@@ -34,67 +93,212 @@ int Log::setOutputFile( const char *filename )
 
 int Log::setOutputLevel( const unsigned int level )
 {
-    m_level= MESSAGE;
-    if(level < MESSAGE)
-        m_level= level;
+    m_level.store((level < MESSAGE) ? level : (unsigned int) MESSAGE, std::memory_order_relaxed);
     //~ if(m_level < ERROR)
         //~ m_error= ERROR;
     return 0;
 }
 
+void Log::flush( )
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    // attend aussi les messages reserves, mais pas encore publies, par les autres threads
+    const unsigned int tail= m_tail.load(std::memory_order_relaxed);
+    drain();
+    while((int) (tail - m_head) > 0)
+    {
+        m_flushed.wait_for(lock, std::chrono::milliseconds(1));
+        drain();
+    }
+    
+    summarize();
+}
+
+bool Log::first( const char *file, const int line, const char *format )
+{
+    // identifie l'appel par les adresses des chaines statiques, sans les parcourir
+    unsigned long long int key= (unsigned long long int) (uintptr_t) file * 0x9E3779B97F4A7C15ull;
+    key^= (unsigned long long int) (uintptr_t) format + 0xBF58476D1CE4E5B9ull + (key << 6) + (key >> 2);
+    key^= (unsigned long long int) line * 0x94D049BB133111EBull;
+    key^= key >> 31;
+    if(key == 0)
+        key= 1;
+    
+    for(unsigned int i= 0; i < SITE_PROBES; i++)
+    {
+        Site& site= m_sites[(key + i) & (SITE_COUNT -1)];
+        unsigned long long int current= site.key.load(std::memory_order_acquire);
+        if(current == 0)
+        {
+            if(site.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+            {
+                // premiere occurrence, complete l'element
+                site.line.store(line, std::memory_order_relaxed);
+                site.file.store(file, std::memory_order_release);
+                site.count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            // current contient la cle inseree par un autre thread
+        }
+        
+        if(current == key)
+        {
+            site.count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    
+    // table pleine, l'appel n'est pas filtre
+    return true;
+}
+
 void Log::write( const unsigned int type, const char *file, const int line, const char *function, const char *format, ... )
 {
-    if(m_output == NULL)
+    if(m_level.load(std::memory_order_relaxed) < type)
         return;
-    
-    if(m_level < type)
+
+#ifndef VERBOSE_DEBUG   // affiche tout les messages en mode debug
+    // n'affiche que la premiere occurence des warnings et erreurs, avant de formater le message
+    if(type != MESSAGE && first(file, line, format) == false)
         return;
+#endif
     
-    std::string message;
+    // reserve un element de la file, sans verrou : l'element est libre lorsque sa sequence est egale a la position
+    unsigned int position= m_tail.load(std::memory_order_relaxed);
+    Record *record;
+    for(;;)
+    {
+        record= &m_records[position & (RECORD_COUNT -1)];
+        const unsigned int sequence= record->sequence.load(std::memory_order_acquire);
+        const int diff= (int) (sequence - position);
+        if(diff == 0)
+        {
+            if(m_tail.compare_exchange_weak(position, position +1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+        {
+            // file pleine, le thread d'ecriture n'a pas encore libere l'element
+            if(type == MESSAGE)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            
+            // les warnings et les erreurs ne sont pas perdus, attend que le thread d'ecriture libere l'element
+            m_wakeup.notify_one();
+            std::this_thread::yield();
+            position= m_tail.load(std::memory_order_relaxed);
+        }
+        else
+            position= m_tail.load(std::memory_order_relaxed);
+    }
     
-    // limite la taille de l'indexation des messages
-    if(m_slots.size() > 1000)
-        message.append("gk::Log( ): too many messages, stop.\n");
+    record->type= type;
+    record->file= file;
+    record->line= line;
     
-    else
+    va_list args;
+    va_start(args, format);
+    vsnprintf(record->text, sizeof(record->text), format, args);
+    va_end(args);
+    
+    // publie le message
+    record->sequence.store(position +1, std::memory_order_release);
+    m_wakeup.notify_one();
+    m_flushed.notify_all();
+}
+
+void Log::writer( )
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    while(m_stop == false)
+    {
+        if(drain() == 0)
+            // les notifications perdues sont rattrapees par le delai
+            m_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+        
+        if(std::chrono::steady_clock::now() - m_summary > std::chrono::seconds(10))
+            summarize();
+    }
+    
+    drain();
+    summarize();
+}
+
+void Log::summarize( )
+{
+    m_summary= std::chrono::steady_clock::now();
+    if(m_output == NULL)
+        return;
+    
+    int count= 0;
+    for(unsigned int i= 0; i < SITE_COUNT; i++)
     {
+        Site& site= m_sites[i];
+        const char *file= site.file.load(std::memory_order_acquire);
+        if(file == NULL)
+            continue;
+        
+        // la premiere occurrence est affichee
+        const unsigned int occurrences= site.count.load(std::memory_order_relaxed);
+        if(occurrences <= site.reported +1)
+            continue;
+        
+        const unsigned int suppressed= occurrences -1;
         char tmp[1024];
+        format_prefix(tmp, sizeof(tmp), file, site.line.load(std::memory_order_relaxed));
+        fprintf(m_output, "%s%u more occurrences.\n", tmp, suppressed - site.reported);
+        site.reported= suppressed;
+        count++;
+    }
+    
+    if(count > 0)
+        fflush(m_output);
+}
+
+int Log::drain( )
+{
+    int count= 0;
+    for(;;)
+    {
+        Record& record= m_records[m_head & (RECORD_COUNT -1)];
+        if(record.sequence.load(std::memory_order_acquire) != m_head +1)
+            break;      // file vide, ou message en cours d'ecriture
         
-        // construit le message indexable
-        if(type != MESSAGE)
-        {
-            // extrait le nom de fichier, sans le chemin d'acces
-            const char *separator= strrchr(file, '/');  // unix 
-            if(separator == NULL)
-                separator= strrchr(file, '\\'); // essaye la convention windows
-            
-            if(separator != 0)
-                separator++;    // saute le separateur, s'il est defini
-            else
-                separator= file;
-                
-        #ifndef _MSC_VER
-            snprintf(tmp, sizeof(tmp), "[%s:%d]\t", separator, line);
-        #else
-            _snprintf(tmp, sizeof(tmp), "[%s:%d]\t", separator, line);
-        #endif
-            message.append(tmp);
-        }
+        output(record);
         
-        va_list args;
-        va_start(args, format);
-        vsnprintf(tmp, sizeof(tmp), format, args);
-        va_end(args);
-        message.append(tmp);
+        // libere l'element pour le prochain tour
+        record.sequence.store(m_head + RECORD_COUNT, std::memory_order_release);
+        m_head++;
+        count++;
+    }
+    
+    const unsigned int dropped= m_dropped.load(std::memory_order_relaxed);
+    if(dropped != m_dropped_reported && m_output != NULL)
+    {
+        fprintf(m_output, "gk::Log( ): %u messages dropped, queue full.\n", dropped - m_dropped_reported);
+        m_dropped_reported= dropped;
     }
+    
+    if(count > 0 && m_output != NULL)
+        fflush(m_output);
+    return count;
+}
 
-#ifndef VERBOSE_DEBUG   // affiche tout les messages en mode debug
-    if(type == MESSAGE 
-    || m_slots.insert(message).second == true)     // n'affiche que la premiere occurence des warnings et erreurs
-#endif
+void Log::output( const Record& record )
+{
+    if(m_output == NULL)
+        return;
+    
+    if(record.type != MESSAGE)
     {
-        fprintf(m_output, "%s", message.c_str());
+        char tmp[1024];
+        format_prefix(tmp, sizeof(tmp), record.file, record.line);
+        fputs(tmp, m_output);
     }
+    
+    fputs(record.text, m_output);
 }
 
 }       // namespace
@@ -0,0 +1,106 @@
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "GL/glew.h"
+#include "GL/freeglut.h"
+
+#include "Buffers.h"
+
+
+static int failures= 0;
+
+static
+void check( const bool test, const char *what, const unsigned int flags )
+{
+    if(test == false)
+    {
+        printf("  failed: %s, flags %u\n", what, flags);
+        failures++;
+    }
+}
+
+//! compares the content of a buffer with a range of an other buffer.
+static
+bool same_content( const GLuint buffer, const GLuint range_buffer, const GLint64 range_offset )
+{
+    if(buffer == 0 || range_buffer == 0)
+        return buffer == range_buffer;
+    
+    GLint64 length= 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &length);
+    std::vector<unsigned char> a(length);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, length, &a.front());
+    
+    std::vector<unsigned char> b(length);
+    glBindBuffer(GL_COPY_READ_BUFFER, range_buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, range_offset, length, &b.front());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return memcmp(&a.front(), &b.front(), length) == 0;
+}
+
+int main( int argc, char **argv )
+{
+    glutInit(&argc, argv);
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_CORE_PROFILE);
+    glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
+    if(glutCreateWindow("arena_test") < 1)
+        return 1;
+    
+    glewExperimental= 1;
+    if(glewInit() != GLEW_OK)
+        return 1;
+    while(glGetError() != GL_NO_ERROR) 
+        {;}
+    
+    printf("arena_test:\n");
+    const char *filename= (argc > 1) ? argv[1] : "bigguy.vbo.obj";
+    
+    // loads the mesh in its own buffers, and in the arena, through each path
+    const unsigned int paths[]= { 0, MESH_STREAM, MESH_OPTIMIZE | MESH_QUANTIZE, MESH_LODS };
+    BufferArena *arena= create_arena(1024 * 1024);
+    for(unsigned int i= 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+        const unsigned int flags= paths[i];
+        Mesh reference= read_OBJ(filename, flags);
+        Mesh mesh= read_OBJ(filename, flags, arena);
+        check(reference.count > 0 && mesh.count == reference.count, "count", flags);
+        check(mesh.positions == mesh.indices && (mesh.normals == 0 || mesh.normals == mesh.positions), "suballocation", flags);
+        
+        check(same_content(reference.positions, mesh.positions, mesh.positions_offset), "positions", flags);
+        check(same_content(reference.texcoords, mesh.texcoords, mesh.texcoords_offset), "texcoords", flags);
+        check(same_content(reference.normals, mesh.normals, mesh.normals_offset), "normals", flags);
+        check(same_content(reference.indices, mesh.indices, mesh.indices_offset), "indices", flags);
+        check(glGetError() == GL_NO_ERROR, "openGL error", flags);
+        
+        release_mesh(reference);
+        release_mesh(mesh, arena);
+    }
+    
+    // all ranges were freed, the next mesh reuses the start of the first block
+    Mesh mesh= read_OBJ(filename, 0, arena);
+    check(mesh.positions_offset == 0, "free / reuse", 0);
+    release_mesh(mesh, arena);
+    
+    // a block without ranges is deleted, except the last one
+    BufferRange ranges[3];
+    for(int i= 0; i < 3; i++)
+        ranges[i]= arena_allocate(arena, 600 * 1024);
+    check(ranges[0].buffer != ranges[1].buffer && ranges[1].buffer != ranges[2].buffer, "one range per block", 0);
+    arena_free(arena, ranges[1].buffer, ranges[1].offset);
+    check(glIsBuffer(ranges[1].buffer) == GL_FALSE, "free block deleted", 0);
+    arena_free(arena, ranges[0].buffer, ranges[0].offset);
+    check(glIsBuffer(ranges[0].buffer) == GL_FALSE, "free block deleted", 0);
+    arena_free(arena, ranges[2].buffer, ranges[2].offset);
+    check(glIsBuffer(ranges[2].buffer) == GL_TRUE, "last block kept", 0);
+    BufferRange range= arena_allocate(arena, 600 * 1024);
+    check(range.buffer == ranges[2].buffer && range.offset == 0, "last block reused", 0);
+    arena_free(arena, range.buffer, range.offset);
+    release_arena(arena);
+    
+    printf(failures ? "failed.\n" : "done.\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+
+#include <cstdio>
+#include <cstring>
+
+#include "TransformHierarchy.h"
+
+using namespace gk;
+
+
+static int failures= 0;
+
+static
+void check( const bool test, const char *what )
+{
+    if(test == false)
+    {
+        printf("  failed: %s\n", what);
+        failures++;
+    }
+}
+
+//! compares the world matrices with a serial recompute, parents are inserted before their children.
+static
+bool check_worlds( const TransformHierarchy& hierarchy )
+{
+    std::vector<Matrix4x4> worlds(hierarchy.size());
+    for(int i= 0; i < hierarchy.size(); i++)
+    {
+        const int parent= hierarchy.parent(i);
+        worlds[i]= (parent < 0) ? hierarchy.local(i) : Matrix4x4::Mul(worlds[parent], hierarchy.local(i));
+        if(memcmp(worlds[i].m, hierarchy.world(i).m, sizeof(float [16])) != 0)
+            return false;
+    }
+    
+    return true;
+}
+
+//! number of nodes in the subtree of node.
+static
+int subtree_size( const TransformHierarchy& hierarchy, const int node )
+{
+    std::vector<unsigned char> inside(hierarchy.size(), 0);
+    int count= 0;
+    for(int i= node; i < hierarchy.size(); i++)
+    {
+        const int parent= hierarchy.parent(i);
+        if(i == node || (parent >= node && inside[parent]))
+        {
+            inside[i]= 1;
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+int main( )
+{
+    printf("hierarchy_test:\n");
+    
+    // 4 children per node, ~9 levels, the large levels are updated in parallel
+    const int n= 200000;
+    TransformHierarchy hierarchy;
+    hierarchy.reserve(n);
+    check(hierarchy.insert(-1, Translate(Vector(1.f, 0.f, 0.f)).matrix()) == 0, "insert root");
+    for(int i= 1; i < n; i++)
+        hierarchy.insert((i -1) / 4, (Translate(Vector(.001f * i, 1.f, 0.f)) * RotateY(float(i % 360))).matrix());
+    check(hierarchy.insert(n, Matrix4x4()) == -1, "insert, invalid parent");
+    check(hierarchy.level(n -1) == hierarchy.level(hierarchy.parent(n -1)) +1, "levels");
+    
+    check(hierarchy.update() == n, "first update, all nodes");
+    check(check_worlds(hierarchy), "first update");
+    check(hierarchy.update() == 0, "no-op update");
+    
+    // a subtree
+    hierarchy.setLocal(1, Translate(Vector(5.f, 5.f, 5.f)).matrix());
+    check(hierarchy.update() == subtree_size(hierarchy, 1), "subtree update, subtree nodes");
+    check(check_worlds(hierarchy), "subtree update");
+    
+    // overlapping subtrees, a node changed twice is updated once
+    hierarchy.setLocal(2, Scale(2.f).matrix());
+    hierarchy.setLocal(9, RotateX(30.f).matrix());
+    hierarchy.setLocal(9, RotateX(45.f).matrix());
+    hierarchy.setLocal(3, Translate(Vector(0.f, 0.f, 1.f)).matrix());
+    hierarchy.setLocal(n -1, Translate(Vector(0.f, 0.f, 1.f)).matrix());
+    check(hierarchy.update() == subtree_size(hierarchy, 2) + subtree_size(hierarchy, 3), "overlapping updates, subtree nodes");
+    check(check_worlds(hierarchy), "overlapping updates");
+    
+    // nodes inserted under an up to date node
+    const int node= hierarchy.insert(4, Translate(Vector(0.f, 1.f, 0.f)).matrix());
+    hierarchy.insert(node, Translate(Vector(1.f, 0.f, 0.f)).matrix());
+    check(hierarchy.update() == 2, "insert update, new nodes");
+    check(check_worlds(hierarchy), "insert update");
+    
+    // the whole hierarchy, in parallel and on the calling thread
+    hierarchy.setLocal(0, Translate(Vector(2.f, 0.f, 0.f)).matrix());
+    check(hierarchy.update(true) == hierarchy.size(), "parallel update, all nodes");
+    check(check_worlds(hierarchy), "parallel update");
+    
+    hierarchy.setLocal(0, Translate(Vector(3.f, 0.f, 0.f)).matrix());
+    check(hierarchy.update(false) == hierarchy.size(), "serial update, all nodes");
+    check(check_worlds(hierarchy), "serial update");
+    check(hierarchy.update() == 0, "no-op update");
+    
+    printf(failures ? "failed.\n" : "done.\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,365 @@
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "MeshIO.h"
+#include "Logger.h"
+
+
+static int failures= 0;
+
+static
+void check( const bool test, const char *what )
+{
+    if(test == false)
+    {
+        printf("  failed: %s\n", what);
+        failures++;
+    }
+}
+
+//! obj file with blocks of 4 positions, texcoords and normals, each followed by a face using relative indices.
+//! the blocks are small, so faces reference attributes of the previous chunk.
+struct ObjFile
+{
+    std::string text;
+    std::vector<float> positions;
+    std::vector<int> corners;
+    int lines;
+    
+    ObjFile( ) : text(), positions(), corners(), lines(0) {}
+    
+    void line( const char *s )
+    {
+        text.append(s);
+        lines++;
+    }
+    
+    void corner( const int p, const int t, const int n )
+    {
+        corners.push_back(p);
+        corners.push_back(t);
+        corners.push_back(n);
+    }
+    
+    //! triangulates a face as a fan, indices are 0 based.
+    void face( const std::vector<int>& face_corners )
+    {
+        for(unsigned int i= 2; i < face_corners.size() / 3; i++)
+        {
+            corner(face_corners[0], face_corners[1], face_corners[2]);
+            corner(face_corners[3*(i-1)], face_corners[3*(i-1) +1], face_corners[3*(i-1) +2]);
+            corner(face_corners[3*i], face_corners[3*i +1], face_corners[3*i +2]);
+        }
+    }
+    
+    void block( const int b )
+    {
+        char tmp[1024];
+        for(int k= 0; k < 4; k++)
+        {
+            sprintf(tmp, "v %d %d.5 -%d\n", b, k, b % 1000);
+            line(tmp);
+            positions.push_back((float) b);
+            positions.push_back((float) k + .5f);
+            positions.push_back(-(float) (b % 1000));
+        }
+        for(int k= 0; k < 4; k++)
+        {
+            sprintf(tmp, "vt %d.25 %d\n", k, b % 100);
+            line(tmp);
+        }
+        for(int k= 0; k < 4; k++)
+        {
+            sprintf(tmp, "vn 0 %d 1\n", k);
+            line(tmp);
+        }
+        
+        const int v= 4 * b;
+        std::vector<int> f;
+        if(b % 3 == 0)
+        {
+            // quad, v/t/n relative indices
+            line("f -4/-4/-4 -3/-3/-3 -2/-2/-2 -1/-1/-1\n");
+            for(int k= 0; k < 4; k++)
+            {
+                f.push_back(v + k);
+                f.push_back(v + k);
+                f.push_back(v + k);
+            }
+        }
+        else if(b % 3 == 1)
+        {
+            // triangle, v//n relative indices
+            line("f -4//-4 -3//-3 -2//-2\n");
+            for(int k= 0; k < 3; k++)
+            {
+                f.push_back(v + k);
+                f.push_back(-1);
+                f.push_back(v + k);
+            }
+        }
+        else
+        {
+            // pentagon, absolute and relative v/t indices
+            sprintf(tmp, "f %d/%d %d/%d -2/-2 -1/-1 %d/%d\n", v +1, v +1, v +2, v +2, v +1, v +4);
+            line(tmp);
+            const int p[5]= { v, v +1, v +2, v +3, v };
+            const int t[5]= { v, v +1, v +2, v +3, v +3 };
+            for(int k= 0; k < 5; k++)
+            {
+                f.push_back(p[k]);
+                f.push_back(t[k]);
+                f.push_back(-1);
+            }
+        }
+        
+        face(f);
+    }
+};
+
+//! returns the content of a text file.
+static
+std::string read_text( const char *filename )
+{
+    std::string text;
+    FILE *in= fopen(filename, "rb");
+    if(in == NULL)
+        return text;
+    
+    char tmp[4096];
+    size_t n;
+    while((n= fread(tmp, 1, sizeof(tmp), in)) > 0)
+        text.append(tmp, n);
+    fclose(in);
+    return text;
+}
+
+//! checks that each corner references a vertex with its attributes, and that each position, texcoord, normal triplet is a single vertex.
+static
+bool check_weld( const ObjData& obj, const std::vector<unsigned int>& indices, 
+    const std::vector<float>& positions, const std::vector<float>& texcoords, const std::vector<float>& normals )
+{
+    const unsigned int corner_count= (unsigned int) obj.corners.size() / 3;
+    if(indices.size() != corner_count)
+        return false;
+    
+    std::map<long long int, unsigned int> vertices;
+    for(unsigned int i= 0; i < corner_count; i++)
+    {
+        const int *corner= &obj.corners[3*i];
+        const unsigned int v= indices[i];
+        if(3*v >= positions.size())
+            return false;
+        
+        // one vertex per triplet, one triplet per vertex
+        const long long int key= (long long int) (corner[0] +1) << 42 | (long long int) (corner[1] +1) << 21 | (long long int) (corner[2] +1);
+        if(vertices.count(key) == 0)
+        {
+            if(v != vertices.size())    // vertices are numbered in order of first use
+                return false;
+            vertices[key]= v;
+        }
+        else if(vertices[key] != v)
+            return false;
+        
+        for(int k= 0; k < 3; k++)
+            if(positions[3*v + k] != obj.positions[3*corner[0] + k])
+                return false;
+        for(int k= 0; k < 2 && !texcoords.empty(); k++)
+            if(texcoords[2*v + k] != ((corner[1] < 0) ? 0.f : obj.texcoords[2*corner[1] + k]))
+                return false;
+        for(int k= 0; k < 3 && !normals.empty(); k++)
+            if(normals[3*v + k] != ((corner[2] < 0) ? 0.f : obj.normals[3*corner[2] + k]))
+                return false;
+    }
+    
+    return positions.size() == 3 * vertices.size();
+}
+
+int main( )
+{
+    printf("obj_parser_test:\n");
+    
+    // ~5MB, parsed in several chunks of 1MB or more
+    const int blocks= 40000;
+    ObjFile file;
+    for(int b= 0; b < blocks; b++)
+        file.block(b);
+    check(file.text.size() > 4*1024*1024, "multi chunk file size");
+    
+    ObjData obj;
+    check(parse_OBJ("relative.obj", file.text.data(), file.text.size(), obj) == 0, "parse");
+    check(obj.positions == file.positions, "positions");
+    check(obj.texcoords.size() == blocks * 4 * 2 && obj.normals.size() == blocks * 4 * 3, "texcoords / normals");
+    check(obj.corners == file.corners, "relative indices across chunks, polygon fans");
+    
+    // the sequential parser gives the same triangles
+    struct Triangles : public ObjStream
+    {
+        std::vector<int> corners;
+        
+        bool position( const float * ) { return true; }
+        bool texcoord( const float * ) { return true; }
+        bool normal( const float * ) { return true; }
+        bool triangle( const int *c ) { corners.insert(corners.end(), c, c + 9); return true; }
+    };
+    Triangles triangles;
+    check(parse_OBJ("relative.obj", file.text.data(), file.text.size(), triangles) == 0 && triangles.corners == file.corners, "stream parser");
+    
+    // a parse error in a later chunk reports its line in the file
+    gk::Log::manager().setOutputFile("obj_parser_test.log");
+    {
+        ObjFile error;
+        int error_line= 0;
+        for(int b= 0; b < blocks; b++)
+        {
+            error.block(b);
+            if(b == blocks * 3 / 4)
+            {
+                error.line("f 1 2\n");
+                error_line= error.lines;
+            }
+        }
+        
+        ObjData error_obj;
+        check(parse_OBJ("error.obj", error.text.data(), error.text.size(), error_obj) < 0, "parse error");
+        
+        gk::Log::manager().flush();
+        char message[1024];
+        sprintf(message, "error loading mesh 'error.obj'. parse error, line %d.\n", error_line);
+        check(read_text("obj_parser_test.log").find(message) != std::string::npos, "parse error line");
+    }
+    
+    // an index referencing a missing attribute
+    {
+        const char *text= "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n";
+        ObjData invalid;
+        check(parse_OBJ("invalid.obj", text, strlen(text), invalid) < 0, "invalid index");
+    }
+    
+    // weld, a quad with a texcoord seam: 4 positions, 5 vertices
+    {
+        const char *text= "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt .5 .5\n"
+            "f 1/1 2/2 3/3\nf 1/1 3/3 4/4\nf 3/5 4/4 1/1\n";
+        ObjData quad;
+        std::vector<unsigned int> indices;
+        std::vector<float> positions, texcoords, normals;
+        check(parse_OBJ("quad.obj", text, strlen(text), quad) == 0, "weld quad, parse");
+        weld_OBJ(quad, indices, positions, texcoords, normals);
+        const unsigned int expected[]= { 0, 1, 2,  0, 2, 3,  4, 3, 0 };
+        check(indices == std::vector<unsigned int>(expected, expected + 9), "weld quad, indices");
+        check(positions.size() == 5 * 3 && texcoords.size() == 5 * 2 && normals.empty(), "weld quad, vertices, no normals");
+        check(check_weld(quad, indices, positions, texcoords, normals), "weld quad");
+    }
+    
+    // weld the parsed file, some corners have no texcoord or no normal
+    {
+        std::vector<unsigned int> indices;
+        std::vector<float> positions, texcoords, normals;
+        weld_OBJ(obj, indices, positions, texcoords, normals);
+        check(check_weld(obj, indices, positions, texcoords, normals), "weld relative.obj");
+    }
+    
+    // weld, few attributes and many triplets, the hash table grows
+    {
+        ObjData triplets;
+        for(int i= 0; i < 64; i++)
+        {
+            const float v[3]= { (float) i, (float) (i * 2), (float) (i * 3) };
+            triplets.positions.insert(triplets.positions.end(), v, v + 3);
+            triplets.texcoords.insert(triplets.texcoords.end(), v, v + 2);
+            triplets.normals.insert(triplets.normals.end(), v, v + 3);
+        }
+        
+        unsigned int random= 1;
+        for(int i= 0; i < 3 * 20000; i++)
+        {
+            random= random * 1103515245u + 12345u;
+            triplets.corners.push_back((random >> 8) % 64);
+            triplets.corners.push_back((int) ((random >> 14) % 65) -1);
+            triplets.corners.push_back((random >> 20) % 64);
+        }
+        
+        std::vector<unsigned int> indices;
+        std::vector<float> positions, texcoords, normals;
+        weld_OBJ(triplets, indices, positions, texcoords, normals);
+        check(positions.size() / 3 > 2048, "weld triplets, vertex count");
+        check(check_weld(triplets, indices, positions, texcoords, normals), "weld triplets");
+    }
+    
+    // cache round trip, the stamp identifies the source file
+    {
+        const char *source= "obj_parser_test.obj";
+        const char *cache= "obj_parser_test.obj.cache";
+        FILE *out= fopen(source, "wb");
+        if(out != NULL)
+        {
+            fwrite(file.text.data(), 1, 4096, out);
+            fclose(out);
+        }
+        
+        FileStamp stamp;
+        check(stamp_file(source, stamp) == 0 && stamp.size == 4096, "stamp");
+        
+        const unsigned int indices[]= { 0, 1, 2,  2, 1, 3 };
+        std::vector<CacheSection> sections(3);
+        sections[0].id= 1; sections[0].length= obj.positions.size() * sizeof(float); sections[0].data= &obj.positions.front();
+        sections[1].id= 2; sections[1].length= 0; sections[1].data= NULL;
+        sections[2].id= 3; sections[2].length= sizeof(indices); sections[2].data= indices;
+        check(write_cache(cache, stamp, 42, sections) == 0, "write cache");
+        
+        MappedFile mapped;
+        std::vector<CacheSection> read;
+        check(read_cache(cache, stamp, 42, mapped, read) == 0, "read cache");
+        bool same= (read.size() == sections.size());
+        for(unsigned int i= 0; same && i < read.size(); i++)
+            same= read[i].id == sections[i].id && read[i].length == sections[i].length 
+                && ((size_t) read[i].data & 63) == 0
+                && memcmp(read[i].data, sections[i].data, read[i].length) == 0;
+        check(same, "cache sections");
+        if(read.size() > 0)
+            unmap_file(mapped);
+        
+        // options, modification time, or content of the source changed
+        check(read_cache(cache, stamp, 43, mapped, read) < 0 && read.empty(), "cache key mismatch");
+        FileStamp changed= stamp;
+        changed.mtime++;
+        check(read_cache(cache, changed, 42, mapped, read) < 0, "cache mtime mismatch");
+        
+        out= fopen(source, "r+b");
+        if(out != NULL)
+        {
+            fputc('#', out);        // same size, maybe the same modification time
+            fclose(out);
+        }
+        check(stamp_file(source, changed) == 0 && changed.hash != stamp.hash, "stamp hash");
+        check(read_cache(cache, changed, 42, mapped, read) < 0, "cache content mismatch");
+        
+        // truncated cache
+        const std::string content= read_text(cache);
+        out= fopen(cache, "wb");
+        if(out != NULL)
+        {
+            fwrite(content.data(), 1, content.size() - 16, out);
+            fclose(out);
+        }
+        check(read_cache(cache, stamp, 42, mapped, read) < 0, "truncated cache");
+        
+        FILE *tmp= fopen((std::string(cache) + ".tmp").c_str(), "rb");
+        check(tmp == NULL, "no temporary cache file");
+        if(tmp != NULL)
+            fclose(tmp);
+        
+        remove(source);
+        remove(cache);
+        check(read_cache(cache, stamp, 42, mapped, read) < 0, "missing cache");
+    }
+    
+    remove("obj_parser_test.log");
+    printf(failures ? "failed.\n" : "done.\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+
+#include "Transform.h"
+
+using namespace gk;
+
+
+//! reference, scalar product.
+static
+Matrix4x4 scalar_mul( const Matrix4x4& a, const Matrix4x4& b )
+{
+    Matrix4x4 r;
+    for(int i = 0; i < 4; ++i)
+        for(int j = 0; j < 4; ++j)
+            r.m[i][j] = 
+                a.m[i][0] * b.m[0][j] +
+                a.m[i][1] * b.m[1][j] +
+                a.m[i][2] * b.m[2][j] +
+                a.m[i][3] * b.m[3][j];
+    return r;
+}
+
+static
+double elapsed( const std::chrono::high_resolution_clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//! keeps the results alive.
+static volatile float sink= 0.f;
+
+int main( )
+{
+    printf("transform_bench:\n");
+    
+    const Transform projection= Perspective(50.f, 16.f / 9.f, .1f, 1000.f);
+    const Transform view= LookAt(Point(0.f, 2.f, 10.f), Point(0.f, 0.f, 0.f), Vector(0.f, 1.f, 0.f));
+    const Transform model= Translate(Vector(1.f, 2.f, 3.f)) * RotateY(30.f) * Scale(2.f);
+    
+    // projection * view * model, per frame, per object
+    const int chains= 1000000;
+    std::chrono::high_resolution_clock::time_point start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Matrix4x4 mvp= scalar_mul(scalar_mul(projection.matrix(), view.matrix()), model.matrix());
+        sink= sink + mvp.m[0][0];
+    }
+    double scalar= elapsed(start);
+    
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Matrix4x4 mvp= Matrix4x4::Mul(Matrix4x4::Mul(projection.matrix(), view.matrix()), model.matrix());
+        sink= sink + mvp.m[0][0];
+    }
+    double simd= elapsed(start);
+    printf("  projection * view * model: scalar %.1fns, Matrix4x4::Mul( ) %.1fns, x%.2f\n", 
+        scalar * 1e6 / chains, simd * 1e6 / chains, scalar / simd);
+    
+    // the same chain, with Transform::operator* and Compose( )
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Transform mvp= projection * view * model;
+        sink= sink + mvp.matrix().m[0][0];
+    }
+    double product= elapsed(start);
+    
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Transform mvp= Compose(projection, view, model);
+        sink= sink + mvp.matrix().m[0][0];
+    }
+    double compose= elapsed(start);
+    printf("  projection * view * model: Transform::operator* %.1fns, Compose( ) %.1fns, x%.2f\n", 
+        product * 1e6 / chains, compose * 1e6 / chains, product / compose);
+    
+    // the inverse of the chain: general inversion, or product of the known inverses
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Transform mvp= Compose(projection, view, model);
+        sink= sink + mvp.inverseMatrix().m[0][0];
+    }
+    double inversion= elapsed(start);
+    
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < chains; i++)
+    {
+        Transform mvp= Compose(projection, view, model).transformWithInverse();
+        sink= sink + mvp.inverseMatrix().m[0][0];
+    }
+    double inverses= elapsed(start);
+    printf("  inverse of projection * view * model: inverseMatrix( ) %.1fns, transformWithInverse( ) %.1fns, x%.2f\n", 
+        inversion * 1e6 / chains, inverses * 1e6 / chains, inversion / inverses);
+    
+    // point arrays
+    const int n= 1000000;
+    std::vector<Point> points(n);
+    std::vector<Point> result(n);
+    for(int i= 0; i < n; i++)
+        points[i]= Point((float) rand() / RAND_MAX, (float) rand() / RAND_MAX, (float) rand() / RAND_MAX);
+    
+    const Matrix4x4 mvp= (projection * view * model).matrix();
+    start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < n; i++)
+        result[i]= Matrix4x4::Transform(mvp, points[i]);
+    scalar= elapsed(start);
+    sink= sink + result[n / 2].x;
+    
+    start= std::chrono::high_resolution_clock::now();
+    Matrix4x4::Transform(mvp, &points.front(), &result.front(), n);
+    simd= elapsed(start);
+    sink= sink + result[n / 2].x;
+    printf("  %d points: scalar %.2fms, Matrix4x4::Transform( ) %.2fms, x%.2f\n", n, scalar, simd, scalar / simd);
+    
+    return 0;
+}
@@ -0,0 +1,185 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "Transform.h"
+
+using namespace gk;
+
+
+static int failures= 0;
+
+static
+void check( const bool test, const char *what )
+{
+    if(test == false)
+    {
+        printf("  failed: %s\n", what);
+        failures++;
+    }
+}
+
+static
+float random( const float a, const float b )
+{
+    return a + (b - a) * (float) rand() / (float) RAND_MAX;
+}
+
+static
+Matrix4x4 random_matrix( const bool projective )
+{
+    Matrix4x4 m;
+    for(int i= 0; i < 3; i++)
+        for(int j= 0; j < 4; j++)
+            m.m[i][j]= random(-2.f, 2.f);
+    
+    // w in [1.7, 2.3] for points in [-1 1]
+    if(projective)
+        for(int j= 0; j < 4; j++)
+            m.m[3][j]= (j < 3) ? random(-.1f, .1f) : 2.f;
+    return m;
+}
+
+//! reference, scalar product, same order of operations.
+static
+Matrix4x4 scalar_mul( const Matrix4x4& a, const Matrix4x4& b )
+{
+    Matrix4x4 r;
+    for(int i = 0; i < 4; ++i)
+        for(int j = 0; j < 4; ++j)
+            r.m[i][j] = 
+                a.m[i][0] * b.m[0][j] +
+                a.m[i][1] * b.m[1][j] +
+                a.m[i][2] * b.m[2][j] +
+                a.m[i][3] * b.m[3][j];
+    return r;
+}
+
+static
+bool same_point( const Point& a, const Point& b )
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+int main( )
+{
+    printf("transform_test:\n");
+    srand(1);
+    
+    // simd matrix products, bit exact with the scalar product
+    int mul_errors= 0;
+    for(int i= 0; i < 10000; i++)
+    {
+        Matrix4x4 a= random_matrix(i & 1);
+        Matrix4x4 b= random_matrix(i & 2);
+        Matrix4x4 r= Matrix4x4::Mul(a, b);
+        Matrix4x4 s= scalar_mul(a, b);
+        if(memcmp(r.m, s.m, sizeof(r.m)) != 0)
+            mul_errors++;
+    }
+    check(mul_errors == 0, "Matrix4x4::Mul( ) / scalar product");
+    
+    // simd point arrays, bit exact with Matrix4x4::Transform(m, p), 
+    // 1005 points: 125 x 8 avx, then 4 sse and 1 scalar
+    const int n= 1005;
+    std::vector<Point> points(n);
+    for(int i= 0; i < n; i++)
+        points[i]= Point(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f));
+    
+    for(int k= 0; k < 2; k++)
+    {
+        const Matrix4x4 m= random_matrix(k == 1);
+        std::vector<Point> result(n);
+        Matrix4x4::Transform(m, &points.front(), &result.front(), n);
+        
+        int errors= 0;
+        for(int i= 0; i < n; i++)
+            if(same_point(result[i], Matrix4x4::Transform(m, points[i])) == false)
+                errors++;
+        check(errors == 0, k ? "Matrix4x4::Transform( ) projective points" : "Matrix4x4::Transform( ) affine points");
+        
+        // in place
+        std::vector<Point> inplace(points);
+        Matrix4x4::Transform(m, &inplace.front(), &inplace.front(), n);
+        check(memcmp(&inplace.front(), &result.front(), n * sizeof(Point)) == 0, "Matrix4x4::Transform( ) in place");
+        
+        // short arrays
+        errors= 0;
+        for(int count= 1; count < 20; count++)
+        {
+            Matrix4x4::Transform(m, &points.front(), &result.front(), count);
+            for(int i= 0; i < count; i++)
+                if(same_point(result[i], Matrix4x4::Transform(m, points[i])) == false)
+                    errors++;
+        }
+        check(errors == 0, "Matrix4x4::Transform( ) short arrays");
+    }
+    
+    // Compose( ), same matrix as operator*, the inverse is computed on first use
+    {
+        const Transform projection= Perspective(50.f, 1.5f, .1f, 100.f);
+        const Transform view= LookAt(Point(0.f, 2.f, 10.f), Point(0.f, 0.f, 0.f), Vector(0.f, 1.f, 0.f));
+        const Transform model= Translate(Vector(1.f, 2.f, 3.f)) * Scale(2.f);
+        const Transform product= projection * view * model;
+        const Transform chain= Compose(projection, view, model);
+        check(memcmp(chain.matrix().m, product.matrix().m, sizeof(float [16])) == 0, "Compose( ) matrix");
+        check(chain.hasInverse() == false, "Compose( ) lazy inverse");
+        check(memcmp(chain.inverseMatrix().m, product.inverseMatrix().m, sizeof(float [16])) == 0, "Compose( ) inverse");
+        
+        // product of the inverses, without general inversion
+        const Transform inverse_chain= Compose(projection, view, model).transformWithInverse();
+        check(inverse_chain.hasInverse(), "transformWithInverse( ), known inverse");
+        check(memcmp(inverse_chain.matrix().m, product.matrix().m, sizeof(float [16])) == 0, "transformWithInverse( ) matrix");
+        const Matrix4x4 identity= Matrix4x4::Mul(inverse_chain.matrix(), inverse_chain.inverseMatrix());
+        float error= 0.f;
+        for(int i= 0; i < 4; i++)
+            for(int j= 0; j < 4; j++)
+                error= std::max(error, std::fabs(identity.m[i][j] - (i == j ? 1.f : 0.f)));
+        check(error < 1e-4f, "transformWithInverse( ) inverse");
+    }
+    
+    // batch transforms, split over the worker threads, same results as the serial transforms
+    {
+        const int count= 200000;
+        std::vector<float> x(count), y(count), z(count), aos(3 * count);
+        for(int i= 0; i < count; i++)
+        {
+            x[i]= aos[3*i]= random(-1.f, 1.f);
+            y[i]= aos[3*i +1]= random(-1.f, 1.f);
+            z[i]= aos[3*i +2]= random(-1.f, 1.f);
+        }
+        
+        const Transform t( random_matrix(true) );
+        std::vector<float> serial(4 * count), parallel(4 * count);
+        t.transformPoints(&aos.front(), &serial.front(), count, false);
+        t.transformPoints(&aos.front(), &parallel.front(), count, true);
+        int errors= memcmp(&serial.front(), &parallel.front(), 3 * count * sizeof(float)) != 0;
+        for(int i= 0; i < count; i++)
+            if(same_point(Point(serial[3*i], serial[3*i +1], serial[3*i +2]), t(Point(x[i], y[i], z[i]))) == false)
+                errors++;
+        check(errors == 0, "transformPoints( ) parallel");
+        
+        std::vector<float> rx(count), ry(count), rz(count);
+        t.transformPoints(&x.front(), &y.front(), &z.front(), &rx.front(), &ry.front(), &rz.front(), count, true);
+        errors= 0;
+        for(int i= 0; i < count; i++)
+            if(rx[i] != serial[3*i] || ry[i] != serial[3*i +1] || rz[i] != serial[3*i +2])
+                errors++;
+        check(errors == 0, "transformPoints( ) soa parallel");
+        
+        t.transformVectors(&aos.front(), &serial.front(), count, false);
+        t.transformVectors(&aos.front(), &parallel.front(), count, true);
+        check(memcmp(&serial.front(), &parallel.front(), 3 * count * sizeof(float)) == 0, "transformVectors( ) parallel");
+        
+        t.transformClip(&aos.front(), &serial.front(), count, false);
+        t.transformClip(&aos.front(), &parallel.front(), count, true);
+        check(memcmp(&serial.front(), &parallel.front(), 4 * count * sizeof(float)) == 0, "transformClip( ) parallel");
+    }
+    
+    printf(failures ? "failed.\n" : "done.\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include "MeshIO.h"
+#include "DebugDrawAnalysis.h"
+
+using namespace gk::debug;
+
+
+static int failures= 0;
+
+static
+void check( const bool test, const char *what )
+{
+    if(test == false)
+    {
+        printf("  failed: %s\n", what);
+        failures++;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    printf("vertex_cache_test:\n");
+    
+    // 3 triangles sharing vertex 0, fifo and lru 3 differ on the last triangle
+    const unsigned int fan[]= { 0, 1, 2,  0, 3, 4,  0, 5, 6 };
+    vertex_cache_stats fifo= simulate_vertex_cache(fan, 9, VERTEX_CACHE_FIFO, 3);
+    vertex_cache_stats lru= simulate_vertex_cache(fan, 9, VERTEX_CACHE_LRU, 3);
+    check(fifo.triangles == 3 && fifo.vertices == 7, "fan: triangles / vertices");
+    check(fifo.misses == 8, "fan: fifo 3 misses");
+    check(lru.misses == 7, "fan: lru 3 misses");
+    check(std::fabs(lru.atvr - 1.f) < 1e-6f, "fan: lru 3 atvr");
+    
+    // 2 triangles sharing an edge, each vertex transformed once
+    const unsigned int quad[]= { 0, 1, 2,  2, 1, 3 };
+    fifo= simulate_vertex_cache(quad, 6, VERTEX_CACHE_FIFO, 16);
+    check(fifo.misses == 4 && std::fabs(fifo.acmr - 2.f) < 1e-6f, "quad: fifo 16 acmr");
+    
+    // empty cache, no statistics
+    fifo= simulate_vertex_cache(quad, 6, VERTEX_CACHE_FIFO, 0);
+    check(fifo.misses == 0 && fifo.triangles == 0, "quad: fifo 0");
+    
+    // baseline, bigguy in file order
+    const char *filename= (argc > 1) ? argv[1] : "bigguy.vbo.obj";
+    MappedFile file;
+    ObjData obj;
+    if(map_file(filename, file) < 0 || parse_OBJ(filename, file.data, file.size, obj) < 0)
+    {
+        printf("  failed: loading '%s'\n", filename);
+        return 1;
+    }
+    unmap_file(file);
+    
+    std::vector<unsigned int> indices;
+    std::vector<float> positions, texcoords, normals;
+    weld_OBJ(obj, indices, positions, texcoords, normals);
+    
+    fifo= simulate_vertex_cache(&indices.front(), (int) indices.size(), VERTEX_CACHE_FIFO, 16);
+    lru= simulate_vertex_cache(&indices.front(), (int) indices.size(), VERTEX_CACHE_LRU, 32);
+    printf("  %s: %d triangles, %d vertices, fifo 16 acmr %.3f atvr %.3f, lru 32 acmr %.3f atvr %.3f\n", filename, 
+        fifo.triangles, fifo.vertices, fifo.acmr, fifo.atvr, lru.acmr, lru.atvr);
+    check(fifo.vertices == (int) positions.size() / 3, "bigguy: vertices");
+    check(std::fabs(fifo.acmr - 1.777f) < 0.0005f && std::fabs(fifo.atvr - 2.938f) < 0.0005f, "bigguy: fifo 16 baseline");
+    check(lru.misses <= fifo.misses, "bigguy: lru 32 vs fifo 16");
+    
+    printf(failures ? "failed.\n" : "done.\n");
+    return failures ? 1 : 0;
+}